@@ -0,0 +1,370 @@
+#ifndef ASYNC_HPP
+#define ASYNC_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <expected>
+#include <format>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "chapter2/chapter2.hpp"
+#include "error.hpp"
+#include "matrix.hpp"
+#include "parallel.hpp"
+
+using std::vector;
+
+/// Elements processed between two cancellation checks / progress reports.
+inline constexpr size_t ASYNC_CHUNK_SIZE = 1 << 16;
+
+/**
+ * @brief Read side of a cancellation flag, checked at chunk boundaries
+ */
+class CancellationToken {
+  private:
+    std::shared_ptr<const std::atomic<bool>> m_flag;
+
+  public:
+    CancellationToken() = default;
+    explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> flag)
+        : m_flag(std::move(flag)) {}
+
+    [[nodiscard]] bool cancelled() const noexcept {
+        return m_flag && m_flag->load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Write side of a cancellation flag
+ */
+class CancellationSource {
+  private:
+    std::shared_ptr<std::atomic<bool>> m_flag =
+        std::make_shared<std::atomic<bool>>(false);
+
+  public:
+    [[nodiscard]] CancellationToken token() const {
+        return CancellationToken(m_flag);
+    }
+
+    void cancel() noexcept { m_flag->store(true, std::memory_order_relaxed); }
+};
+
+/**
+ * @brief Options shared by the asynchronous entry points
+ */
+struct AsyncOptions {
+    /// Executor to run on; nullptr means default_pool().
+    ThreadPool *pool = nullptr;
+    /// Checked before every chunk; once set, the operation stops early.
+    CancellationToken token = {};
+    /// Called after every chunk with (units done, units in total).
+    std::function<void(size_t done, size_t total)> progress = {};
+
+    [[nodiscard]] ThreadPool &executor() const {
+        return pool != nullptr ? *pool : default_pool();
+    }
+};
+
+template <typename T> class Task;
+
+namespace detail {
+
+template <typename T> struct TaskResult {
+    std::optional<T> value;
+
+    void return_value(T v) { value.emplace(std::move(v)); }
+    auto take() -> T { return std::move(*value); }
+};
+
+template <> struct TaskResult<void> {
+    void return_void() noexcept {}
+    void take() noexcept {}
+};
+
+template <typename T> struct TaskPromise : TaskResult<T> {
+    std::exception_ptr error;
+    std::coroutine_handle<> continuation;
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        auto await_suspend(std::coroutine_handle<TaskPromise> h) noexcept
+            -> std::coroutine_handle<> {
+            auto next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    auto get_return_object() -> Task<T>;
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+} // namespace detail
+
+/**
+ * @brief Lazily started coroutine producing a T
+ *
+ * The body starts when the task is awaited, and the awaiting coroutine is
+ * resumed directly (symmetric transfer) on whichever thread finishes the
+ * body. Exceptions propagate to the awaiter.
+ */
+template <typename T> class Task {
+  public:
+    using promise_type = detail::TaskPromise<T>;
+
+  private:
+    std::coroutine_handle<promise_type> m_handle;
+
+  public:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle) {}
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    Task(Task &&other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr)) {}
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+    ~Task() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    auto await_suspend(std::coroutine_handle<> caller) noexcept
+        -> std::coroutine_handle<> {
+        m_handle.promise().continuation = caller;
+        return m_handle;
+    }
+
+    auto await_resume() -> T {
+        if (m_handle.promise().error) {
+            std::rethrow_exception(m_handle.promise().error);
+        }
+        return m_handle.promise().take();
+    }
+};
+
+template <typename T>
+auto detail::TaskPromise<T>::get_return_object() -> Task<T> {
+    return Task<T>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+}
+
+/**
+ * @brief Awaitable that moves the awaiting coroutine onto `pool`
+ */
+struct ScheduleOn {
+    ThreadPool &pool;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) const {
+        pool.submit([h] { h.resume(); });
+    }
+    void await_resume() const noexcept {}
+};
+
+inline auto schedule_on(ThreadPool &pool) -> ScheduleOn { return {pool}; }
+
+namespace detail {
+
+/// Fire-and-forget coroutine: starts eagerly and frees itself when done.
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+template <typename T, typename F>
+auto drive(Task<T> task, F on_done) -> Detached {
+    std::exception_ptr error;
+    if constexpr (std::is_void_v<T>) {
+        try {
+            co_await task;
+        } catch (...) {
+            error = std::current_exception();
+        }
+        on_done(error);
+    } else {
+        std::optional<T> value;
+        try {
+            value.emplace(co_await task);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        on_done(error, std::move(value));
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Blocks the calling thread until `task` completes and returns its
+ * result, for callers that are not coroutines themselves
+ */
+template <typename T> auto sync_wait(Task<T> task) -> T {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    std::exception_ptr error;
+    std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> value;
+
+    auto finish = [&](std::exception_ptr e, auto &&...result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::move(e);
+        if constexpr (sizeof...(result) > 0) {
+            if (!error) {
+                value.emplace(std::move(*result)...);
+            }
+        }
+        done = true;
+        // Notify under the lock so the waiter cannot return and destroy
+        // `cv` before the notification is delivered.
+        cv.notify_one();
+    };
+    detail::drive(std::move(task), finish);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return done; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*value);
+    }
+}
+
+/**
+ * @brief Runs `f()` on the options' executor and completes with its result
+ *
+ * The generic way to offload any long call (a sort from chapter 2, a
+ * matrix kernel, ...) from a request handler.
+ */
+template <typename F>
+auto run_async(F f, AsyncOptions options = {})
+    -> Task<std::invoke_result_t<F &>> {
+    co_await schedule_on(options.executor());
+    co_return f();
+}
+
+/**
+ * @brief Merge sort on a background executor
+ *
+ * Bottom-up over chunks of ASYNC_CHUNK_SIZE elements: every chunk is sorted
+ * with `merge_sort_helper`, then sorted blocks are paired up with `merge`,
+ * doubling in width. Between chunks and merges the cancellation token is
+ * checked and progress is reported in elements processed.
+ *
+ * `arr` must outlive the task. When cancelled, the task completes with an
+ * error and `arr` holds a permutation of its original contents.
+ */
+template <typename T>
+    requires requires(const T &a, const T &b) {
+        { a <= b } -> std::convertible_to<bool>;
+    }
+auto async_merge_sort(vector<T> &arr, AsyncOptions options = {})
+    -> Task<std::expected<void, Error>> {
+    co_await schedule_on(options.executor());
+
+    size_t n = arr.size();
+    size_t passes = 0;
+    for (size_t width = ASYNC_CHUNK_SIZE; width < n; width *= 2) {
+        passes++;
+    }
+    size_t total = n * (1 + passes);
+    size_t done = 0;
+    auto step = [&](size_t units) -> bool {
+        done += units;
+        if (options.progress) {
+            options.progress(done, total);
+        }
+        return !options.token.cancelled();
+    };
+
+    if (options.token.cancelled()) {
+        co_return std::unexpected<Error>(Error::Cancelled("merge sort"));
+    }
+    for (size_t lo = 0; lo < n; lo += ASYNC_CHUNK_SIZE) {
+        size_t hi = std::min(lo + ASYNC_CHUNK_SIZE, n);
+        merge_sort_helper(arr, lo, hi);
+        if (!step(hi - lo)) {
+            co_return std::unexpected<Error>(Error::Cancelled("merge sort"));
+        }
+    }
+    for (size_t width = ASYNC_CHUNK_SIZE; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = std::min(lo + width, n);
+            size_t hi = std::min(lo + 2 * width, n);
+            if (mid < hi) {
+                merge(arr, lo, mid, hi);
+            }
+            if (!step(hi - lo)) {
+                co_return std::unexpected<Error>(
+                    Error::Cancelled("merge sort"));
+            }
+        }
+    }
+    co_return std::expected<void, Error>{};
+}
+
+/**
+ * @brief Matrix::transpose on a background executor
+ *
+ * Works in blocks of rows of about ASYNC_CHUNK_SIZE elements, checking the
+ * cancellation token and reporting progress (in elements) after each.
+ * `matrix` must outlive the task.
+ */
+template <typename T>
+    requires std::copy_constructible<T>
+auto async_transpose(const Matrix<T> &matrix, AsyncOptions options = {})
+    -> Task<std::expected<Matrix<T>, Error>> {
+    co_await schedule_on(options.executor());
+
+    size_t rows = matrix.nrows();
+    size_t cols = matrix.ncols();
+    size_t total = rows * cols;
+    size_t block =
+        std::max<size_t>(1, ASYNC_CHUNK_SIZE / std::max<size_t>(1, cols));
+    Matrix<T> result(cols, rows);
+    for (size_t r0 = 0; r0 < rows; r0 += block) {
+        if (options.token.cancelled()) {
+            co_return std::unexpected<Error>(Error::Cancelled("transpose"));
+        }
+        size_t r1 = std::min(r0 + block, rows);
+        for (size_t i = r0; i < r1; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                result.get_unchecked(j, i) = matrix.get_unchecked(i, j);
+            }
+        }
+        if (options.progress) {
+            options.progress(r1 * cols, total);
+        }
+    }
+    co_return std::move(result);
+}
+
+#endif // ASYNC_HPP
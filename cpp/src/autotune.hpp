@@ -0,0 +1,374 @@
+#ifndef AUTOTUNE_HPP
+#define AUTOTUNE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "batched_gemm.hpp"
+#include "chapter2/chapter2.hpp"
+#include "chapter2/inversions.hpp"
+#include "chapter2/selection.hpp"
+#include "chapter2/string_sort.hpp"
+#include "chapter4/chapter4.hpp"
+#include "linalg.hpp"
+#include "matrix.hpp"
+#include "memory.hpp"
+#include "quantized.hpp"
+#include "reduction.hpp"
+#include "scan.hpp"
+#include "tuning.hpp"
+
+using std::vector;
+
+/**
+ * @brief Problem sizes used by `autotune`
+ *
+ * Large enough to fall out of L2 on current machines, small enough that a
+ * full run takes seconds.
+ */
+struct AutotuneOptions {
+    /// Keys sorted by `merge_sort` and searched by `introselect`; a quarter
+    /// as many points go to `closest_pair`.
+    size_t sort_length = 1 << 17;
+    size_t gemm_size = 384;        ///< Order of the matrices multiplied
+    size_t lu_size = 512;          ///< Order of the matrix factored
+    size_t repeats = 3;            ///< Runs per candidate; the fastest counts
+    /// Largest input used to place the parallel cutoffs; each kernel also
+    /// runs on a quarter, a sixteenth and a sixty-fourth of it.
+    size_t cutoff_length = 1 << 17;
+    /// Multiply-adds per `gemm_batched` call, for each matrix size tried.
+    size_t batch_flops = 1 << 21;
+    /// Largest buffer filled to place the streaming-store threshold; should
+    /// be well beyond the last-level cache.
+    size_t fill_bytes = 1 << 26;
+};
+
+namespace detail {
+
+/// Fastest of `repeats` runs of `run`, each after an untimed `setup`.
+template <typename Setup, typename Run>
+auto best_seconds(size_t repeats, Setup &&setup, Run &&run) -> double {
+    double best = std::numeric_limits<double>::infinity();
+    for (size_t r = 0; r < std::max<size_t>(repeats, 1); r++) {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        run();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+/// `largest` and three lengths below it, each a quarter of the previous one.
+inline auto cutoff_lengths(size_t largest) -> vector<size_t> {
+    vector<size_t> lengths;
+    for (size_t len = std::max<size_t>(largest, 64); lengths.size() < 4;
+         len /= 4) {
+        lengths.push_back(len);
+    }
+    return lengths;
+}
+
+/**
+ * Sets `profile.*member` to each candidate in turn, times `benchmark` under
+ * that profile and keeps the fastest candidate. Parameters are tuned one at
+ * a time, each with the best values found for the earlier ones.
+ */
+template <typename Benchmark>
+void tune_parameter(TuningProfile &profile, size_t TuningProfile::*member,
+                    std::initializer_list<size_t> candidates,
+                    Benchmark &&benchmark) {
+    double best = std::numeric_limits<double>::infinity();
+    size_t best_value = profile.*member;
+    for (size_t value : candidates) {
+        TuningProfile trial = profile;
+        trial.*member = value;
+        set_tuning(trial);
+        double seconds = benchmark();
+        if (seconds < best) {
+            best = seconds;
+            best_value = value;
+        }
+    }
+    profile.*member = best_value;
+}
+
+} // namespace detail
+
+/**
+ * @brief Measures the TuningProfile parameters on this machine
+ *
+ * Runs `merge_sort`, `gemm`, `lu_factor`, the selection routines,
+ * `closest_pair`, `msd_radix_sort`, `gemm_batched`, `quantized_matmul` and
+ * `parallel_fill` on random inputs with candidate values of each parameter
+ * and keeps the fastest. Each parallel cutoff is timed over inputs of several
+ * lengths (see `AutotuneOptions::cutoff_length`), so a candidate pays both
+ * for forking small inputs and for keeping large ones on one thread. The
+ * active profile is restored afterwards; install the result with
+ * `set_tuning` or persist it with `save_tuning_profile`.
+ */
+inline auto autotune(const AutotuneOptions &options = {}) -> TuningProfile {
+    TuningProfile original = tuning();
+    TuningProfile profile = original;
+    std::mt19937 gen(2024);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+
+    vector<double> keys(options.sort_length);
+    for (double &x : keys) {
+        x = dist(gen);
+    }
+    vector<double> work;
+    auto sort_time = [&] {
+        return detail::best_seconds(
+            options.repeats, [&] { work = keys; },
+            [&] { merge_sort(work); });
+    };
+    detail::tune_parameter(profile, &TuningProfile::merge_sort_cutoff,
+                           {1, 8, 16, 24, 32, 48, 64}, sort_time);
+
+    size_t n = options.gemm_size;
+    Matrix<double> a(n, n);
+    Matrix<double> b(n, n);
+    Matrix<double> c(n, n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            a(i, j) = dist(gen);
+            b(i, j) = dist(gen);
+        }
+    }
+    auto gemm_time = [&] {
+        return detail::best_seconds(
+            options.repeats, [] {},
+            [&] {
+                (void)gemm(1.0, a.view(0, 0, n, n), b.view(0, 0, n, n), 0.0,
+                           c.view_mut(0, 0, n, n));
+            });
+    };
+    detail::tune_parameter(profile, &TuningProfile::gemm_block_k,
+                           {64, 128, 256, 512, 1024}, gemm_time);
+    detail::tune_parameter(profile, &TuningProfile::gemm_row_grain,
+                           {4, 8, 16, 32, 64, 128}, gemm_time);
+
+    size_t m = options.lu_size;
+    Matrix<double> source(m, m);
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < m; j++) {
+            source(i, j) = dist(gen) + (i == j ? double(m) : 0.0);
+        }
+    }
+    Matrix<double> lu(m, m);
+    auto lu_time = [&] {
+        return detail::best_seconds(
+            options.repeats, [&] { lu = source; },
+            [&] { (void)lu_factor(lu.view_mut(0, 0, m, m)); });
+    };
+    detail::tune_parameter(profile, &TuningProfile::lu_block,
+                           {16, 32, 64, 128, 256}, lu_time);
+    detail::tune_parameter(profile, &TuningProfile::lu_parallel_rows,
+                           {128, 256, 512, 1024, 2048}, lu_time);
+
+    auto select_time = [&] {
+        return detail::best_seconds(
+            options.repeats, [&] { work = keys; },
+            [&] { (void)introselect(work, work.size() / 2); });
+    };
+    detail::tune_parameter(profile, &TuningProfile::select_small,
+                           {8, 16, 32, 64, 128}, select_time);
+
+    vector<double> xs(options.sort_length / 4);
+    vector<double> ys(options.sort_length / 4);
+    for (size_t i = 0; i < xs.size(); i++) {
+        xs[i] = dist(gen);
+        ys[i] = dist(gen);
+    }
+    auto brute_force_time = [&] {
+        return detail::best_seconds(options.repeats, [] {},
+                                    [&] { (void)closest_pair(xs, ys); });
+    };
+    detail::tune_parameter(profile, &TuningProfile::closest_pair_brute_force,
+                           {4, 8, 12, 16, 24, 32}, brute_force_time);
+
+    // Parallel cutoffs: every kernel runs on each of `lengths` per timing.
+    vector<size_t> lengths = detail::cutoff_lengths(options.cutoff_length);
+    auto tune_cutoff = [&](size_t TuningProfile::*member, auto setup,
+                           auto run) {
+        detail::tune_parameter(
+            profile, member, {1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20},
+            [&] { return detail::best_seconds(options.repeats, setup, run); });
+    };
+    vector<vector<double>> inputs;
+    vector<vector<double>> points_y;
+    vector<Matrix<double>> matrices;
+    for (size_t len : lengths) {
+        vector<double> v(len);
+        vector<double> w(len);
+        for (size_t i = 0; i < len; i++) {
+            v[i] = dist(gen);
+            w[i] = dist(gen);
+        }
+        inputs.push_back(std::move(v));
+        points_y.push_back(std::move(w));
+        Matrix<double> m(len / 64, 64);
+        for (size_t i = 0; i < m.nrows(); i++) {
+            for (size_t j = 0; j < 64; j++) {
+                m(i, j) = dist(gen);
+            }
+        }
+        matrices.push_back(std::move(m));
+    }
+    vector<vector<double>> scratch;
+    auto copy_inputs = [&] { scratch = inputs; };
+
+    tune_cutoff(&TuningProfile::scan_parallel_cutoff, copy_inputs, [&] {
+        for (auto &v : scratch) {
+            inclusive_scan(v);
+        }
+    });
+    tune_cutoff(&TuningProfile::reduce_parallel_min, [] {}, [&] {
+        for (const auto &m : matrices) {
+            (void)row_sums(m);
+        }
+    });
+    vector<double> x(64, 1.0);
+    vector<double> y(lengths.front() / 64);
+    tune_cutoff(&TuningProfile::gemv_parallel_min, [] {}, [&] {
+        for (const auto &m : matrices) {
+            (void)gemv(1.0, m.view(0, 0, m.nrows(), 64),
+                       std::span<const double>(x), 0.0,
+                       std::span<double>(y.data(), m.nrows()));
+        }
+    });
+    tune_cutoff(&TuningProfile::inversions_parallel_cutoff, [] {}, [&] {
+        for (const auto &v : inputs) {
+            (void)parallel_count_inversions(v);
+        }
+    });
+    vector<vector<size_t>> ranks(lengths.size());
+    for (size_t k = 0; k < lengths.size(); k++) {
+        for (size_t q = 1; q < 16; q++) {
+            ranks[k].push_back(lengths[k] * q / 16);
+        }
+    }
+    tune_cutoff(&TuningProfile::multi_select_parallel_cutoff, copy_inputs,
+                [&] {
+                    for (size_t k = 0; k < lengths.size(); k++) {
+                        (void)multi_select(scratch[k], ranks[k]);
+                    }
+                });
+    tune_cutoff(&TuningProfile::closest_pair_parallel_cutoff, [] {}, [&] {
+        for (size_t k = 0; k < lengths.size(); k++) {
+            (void)parallel_closest_pair(inputs[k], points_y[k]);
+        }
+    });
+
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<size_t> word_length(4, 20);
+    vector<std::string> words(options.sort_length / 4);
+    for (auto &word : words) {
+        word.resize(word_length(gen));
+        for (char &ch : word) {
+            ch = static_cast<char>(letter(gen));
+        }
+    }
+    vector<std::string> word_work;
+    auto string_time = [&] {
+        return detail::best_seconds(
+            options.repeats, [&] { word_work = words; },
+            [&] { msd_radix_sort(word_work); });
+    };
+    detail::tune_parameter(profile, &TuningProfile::string_insertion_cutoff,
+                           {4, 8, 16, 24, 32}, string_time);
+    detail::tune_parameter(profile, &TuningProfile::msd_radix_cutoff,
+                           {16, 32, 64, 128, 256}, string_time);
+
+    // Batches of small matrices on both sides of the interleaving limit
+    vector<MatrixBatch<float>> batch_a;
+    vector<MatrixBatch<float>> batch_b;
+    vector<MatrixBatch<float>> batch_c;
+    for (size_t d : {4, 8, 16, 24, 32}) {
+        size_t count = std::max<size_t>(64, options.batch_flops / (d * d * d));
+        batch_a.emplace_back(count, d, d);
+        batch_b.emplace_back(count, d, d);
+        batch_c.emplace_back(count, d, d);
+        for (size_t e = 0; e < count * d * d; e++) {
+            batch_a.back().data()[e] = static_cast<float>(dist(gen));
+            batch_b.back().data()[e] = static_cast<float>(dist(gen));
+        }
+    }
+    auto batch_time = [&] {
+        return detail::best_seconds(options.repeats, [] {}, [&] {
+            for (size_t k = 0; k < batch_a.size(); k++) {
+                (void)gemm_batched(1.0f, batch_a[k].view(), batch_b[k].view(),
+                                   0.0f, batch_c[k].view_mut());
+            }
+        });
+    };
+    detail::tune_parameter(profile, &TuningProfile::gemm_interleave_max,
+                           {4, 8, 16, 24, 32}, batch_time);
+    detail::tune_parameter(profile, &TuningProfile::gemm_batch_task_flops,
+                           {1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20},
+                           batch_time);
+
+    Matrix<float> qa(n, n);
+    Matrix<float> qb(n, n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            qa(i, j) = static_cast<float>(dist(gen));
+            qb(i, j) = static_cast<float>(dist(gen));
+        }
+    }
+    auto qa8 = QuantizedMatrix<int8_t>::quantize(qa);
+    auto qb8 = QuantizedMatrix<int8_t>::quantize(qb);
+    if (qa8 && qb8) {
+        auto quant_time = [&] {
+            return detail::best_seconds(
+                options.repeats, [] {},
+                [&] { (void)quantized_matmul(*qa8, *qb8); });
+        };
+        detail::tune_parameter(profile, &TuningProfile::quant_block_cols,
+                               {16, 32, 64, 128, 256}, quant_time);
+    }
+
+    // Every fill is read back, as the caller of an initializer would, so
+    // streaming stores pay for the cache misses they cause.
+    vector<double> buffer(std::max(options.fill_bytes,
+                                   options.cutoff_length * sizeof(double)) /
+                          sizeof(double));
+    auto tune_fill = [&](size_t TuningProfile::*member,
+                         std::initializer_list<size_t> candidates,
+                         size_t largest) {
+        vector<size_t> sizes = detail::cutoff_lengths(largest);
+        detail::tune_parameter(profile, member, candidates, [&] {
+            return detail::best_seconds(options.repeats, [] {}, [&] {
+                for (size_t bytes : sizes) {
+                    size_t count = std::min(bytes / sizeof(double),
+                                            buffer.size());
+                    parallel_fill(buffer.data(), count, 1.0);
+                    volatile double sum = std::accumulate(
+                        buffer.begin(), buffer.begin() + count, 0.0);
+                    (void)sum;
+                }
+            });
+        });
+    };
+    tune_fill(&TuningProfile::parallel_init_min_bytes,
+              {1 << 14, 1 << 16, 1 << 18, 1 << 20, 1 << 22},
+              options.cutoff_length * sizeof(double));
+    tune_fill(&TuningProfile::stream_store_min_bytes,
+              {1 << 20, 1 << 22, 1 << 23, 1 << 24, 1 << 26},
+              options.fill_bytes);
+
+    set_tuning(original);
+    return profile;
+}
+
+#endif // AUTOTUNE_HPP
@@ -0,0 +1,255 @@
+#ifndef BATCHED_GEMM_HPP
+#define BATCHED_GEMM_HPP
+
+#include <algorithm>
+#include <expected>
+#include <format>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "error.hpp"
+#include "parallel.hpp"
+#include "tuning.hpp"
+
+using std::vector;
+
+/**
+ * @brief `count` matrices of the same shape stored at a fixed distance apart
+ *
+ * Matrix b starts at `data[b * batch_stride]` and is row-major with rows
+ * `cols` apart. T may be const for read-only operands.
+ */
+template <typename T> struct StridedBatch {
+    std::span<T> data;
+    size_t count = 0;
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t batch_stride = 0;
+
+    [[nodiscard]] T *matrix(size_t b) const noexcept {
+        return data.data() + b * batch_stride;
+    }
+};
+
+/**
+ * @brief Owning storage for a batch of equally shaped small matrices
+ *
+ * One allocation for the whole batch, matrices back to back, so no
+ * per-matrix `Matrix<T>` is needed.
+ */
+template <typename T> class MatrixBatch {
+  private:
+    vector<T> m_data;
+    size_t m_count;
+    size_t m_rows;
+    size_t m_cols;
+
+  public:
+    MatrixBatch(size_t count, size_t rows, size_t cols, T value = T{})
+        : m_data(count * rows * cols, value), m_count(count), m_rows(rows),
+          m_cols(cols) {}
+
+    [[nodiscard]] size_t count() const noexcept { return m_count; }
+    [[nodiscard]] size_t nrows() const noexcept { return m_rows; }
+    [[nodiscard]] size_t ncols() const noexcept { return m_cols; }
+    [[nodiscard]] T *data() noexcept { return m_data.data(); }
+    [[nodiscard]] const T *data() const noexcept { return m_data.data(); }
+
+    T &operator()(size_t b, size_t row, size_t col) noexcept {
+        return m_data[(b * m_rows + row) * m_cols + col];
+    }
+    const T &operator()(size_t b, size_t row, size_t col) const noexcept {
+        return m_data[(b * m_rows + row) * m_cols + col];
+    }
+
+    [[nodiscard]] StridedBatch<const T> view() const noexcept {
+        return {m_data, m_count, m_rows, m_cols, m_rows * m_cols};
+    }
+    [[nodiscard]] StridedBatch<T> view_mut() noexcept {
+        return {m_data, m_count, m_rows, m_cols, m_rows * m_cols};
+    }
+};
+
+namespace detail {
+
+/// Matrices multiplied side by side by the interleaved kernel: one cache
+/// line worth of elements per matrix position.
+template <typename T>
+inline constexpr size_t GEMM_BATCH_LANES =
+    std::max<size_t>(1, 64 / sizeof(T));
+
+template <typename T>
+auto batch_fits(const StridedBatch<T> &batch) -> bool {
+    size_t extent = batch.rows * batch.cols;
+    if (batch.count == 0) {
+        return true;
+    }
+    if (batch.count > 1 && batch.batch_stride < extent) {
+        return false;
+    }
+    return (batch.count - 1) * batch.batch_stride + extent <=
+           batch.data.size();
+}
+
+/// C = alpha * A * B + beta * C for one m x k by k x n product.
+template <typename T>
+void small_gemm(T alpha, const T *a, const T *b, T beta, T *c, size_t m,
+                size_t k, size_t n) {
+    for (size_t i = 0; i < m; i++) {
+        T *row = c + i * n;
+        if (beta == T{}) {
+            std::fill_n(row, n, T{});
+        } else if (beta != T{1}) {
+            for (size_t j = 0; j < n; j++) {
+                row[j] *= beta;
+            }
+        }
+        for (size_t p = 0; p < k; p++) {
+            T scale = alpha * a[i * k + p];
+            const T *brow = b + p * n;
+            for (size_t j = 0; j < n; j++) {
+                row[j] += scale * brow[j];
+            }
+        }
+    }
+}
+
+/**
+ * Multiplies GEMM_BATCH_LANES<T> products at once. Operands are transposed
+ * into interleaved scratch blocks where entry (i, j) of every matrix of the
+ * group is contiguous, `block[(i * cols + j) * lanes + l]`, so each
+ * multiply-add of the product becomes one lane-wise SIMD operation across the
+ * group instead of a short, hard to vectorize loop within one matrix.
+ */
+template <typename T>
+void interleaved_gemm(T alpha, const StridedBatch<const T> &a,
+                      const StridedBatch<const T> &b, T beta,
+                      const StridedBatch<T> &c, size_t first, T *ablock,
+                      T *bblock, T *cblock) {
+    constexpr size_t lanes = GEMM_BATCH_LANES<T>;
+    size_t m = a.rows;
+    size_t k = a.cols;
+    size_t n = b.cols;
+    for (size_t l = 0; l < lanes; l++) {
+        const T *am = a.matrix(first + l);
+        const T *bm = b.matrix(first + l);
+        for (size_t e = 0; e < m * k; e++) {
+            ablock[e * lanes + l] = am[e];
+        }
+        for (size_t e = 0; e < k * n; e++) {
+            bblock[e * lanes + l] = bm[e];
+        }
+    }
+    std::fill_n(cblock, m * n * lanes, T{});
+    for (size_t i = 0; i < m; i++) {
+        for (size_t p = 0; p < k; p++) {
+            const T *aip = ablock + (i * k + p) * lanes;
+            for (size_t j = 0; j < n; j++) {
+                const T *bpj = bblock + (p * n + j) * lanes;
+                T *cij = cblock + (i * n + j) * lanes;
+                for (size_t l = 0; l < lanes; l++) {
+                    cij[l] += aip[l] * bpj[l];
+                }
+            }
+        }
+    }
+    for (size_t l = 0; l < lanes; l++) {
+        T *cm = c.matrix(first + l);
+        for (size_t e = 0; e < m * n; e++) {
+            T value = alpha * cblock[e * lanes + l];
+            cm[e] = beta == T{} ? value : value + beta * cm[e];
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief C[b] = alpha * A[b] * B[b] + beta * C[b] for every b in the batch
+ *
+ * Work is split across the batch, never within one product: each task
+ * multiplies a run of whole matrices. When every dimension is at most
+ * `tuning().gemm_interleave_max` the matrices are processed in groups with
+ * `detail::interleaved_gemm` (SIMD across the batch); larger ones use a
+ * plain row-major kernel per matrix. A matrix of C must not overlap A or B.
+ *
+ * @return An error if the batch sizes or shapes disagree, or a span is too
+ * short for its count and stride
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto gemm_batched(T alpha, const StridedBatch<const T> &a,
+                  const StridedBatch<const T> &b, T beta,
+                  const StridedBatch<T> &c) -> std::expected<void, Error> {
+    size_t m = a.rows;
+    size_t k = a.cols;
+    size_t n = b.cols;
+    if (a.count != b.count || a.count != c.count) {
+        return std::unexpected<Error>(Error::InvalidArgument(
+            std::format("batch sizes differ: {}, {} and {}", a.count, b.count,
+                        c.count)));
+    }
+    if (b.rows != k || c.rows != m || c.cols != n) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "cannot multiply {}x{} by {}x{} into {}x{}", m, k, b.rows, n,
+            c.rows, c.cols)));
+    }
+    if (!detail::batch_fits(a) || !detail::batch_fits(b) ||
+        !detail::batch_fits(c)) {
+        return std::unexpected<Error>(Error::InvalidArgument(
+            "batch stride and count exceed the storage"));
+    }
+    size_t count = a.count;
+    size_t flops = std::max<size_t>(1, m * k * n);
+    size_t grain =
+        std::max<size_t>(1, tuning().gemm_batch_task_flops / flops);
+
+    constexpr size_t lanes = detail::GEMM_BATCH_LANES<T>;
+    bool interleave = std::max({m, k, n}) <= tuning().gemm_interleave_max &&
+                      count >= lanes;
+    if (!interleave) {
+        parallel_for(0, count, grain, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; i++) {
+                detail::small_gemm(alpha, a.matrix(i), b.matrix(i), beta,
+                                   c.matrix(i), m, k, n);
+            }
+        });
+        return {};
+    }
+
+    size_t groups = count / lanes;
+    size_t group_grain = std::max<size_t>(1, grain / lanes);
+    parallel_for(0, groups, group_grain, [&](size_t lo, size_t hi) {
+        vector<T> scratch((m * k + k * n + m * n) * lanes);
+        T *ablock = scratch.data();
+        T *bblock = ablock + m * k * lanes;
+        T *cblock = bblock + k * n * lanes;
+        for (size_t g = lo; g < hi; g++) {
+            detail::interleaved_gemm(alpha, a, b, beta, c, g * lanes, ablock,
+                                     bblock, cblock);
+        }
+    });
+    for (size_t i = groups * lanes; i < count; i++) {
+        detail::small_gemm(alpha, a.matrix(i), b.matrix(i), beta, c.matrix(i),
+                           m, k, n);
+    }
+    return {};
+}
+
+/**
+ * @brief Products A[b] * B[b] of two owning batches
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto matmul_batched(const MatrixBatch<T> &a, const MatrixBatch<T> &b)
+    -> std::expected<MatrixBatch<T>, Error> {
+    MatrixBatch<T> c(a.count(), a.nrows(), b.ncols());
+    auto status = gemm_batched(T{1}, a.view(), b.view(), T{}, c.view_mut());
+    if (!status) {
+        return std::unexpected<Error>(status.error());
+    }
+    return c;
+}
+
+#endif // BATCHED_GEMM_HPP
@@ -0,0 +1,163 @@
+// Argsort, key-extractor and key/payload sorting.
+
+#ifndef ARGSORT_HPP
+#define ARGSORT_HPP
+
+#include <expected>
+#include <format>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "chapter2.hpp"
+#include "chapter2/powersort.hpp"
+#include "error.hpp"
+
+using std::vector;
+
+namespace detail {
+
+/// An extracted sort key together with the position it came from.
+template <LessComparable K> struct KeyedIndex {
+    K key;
+    size_t index;
+
+    bool operator<(const KeyedIndex &other) const { return key < other.key; }
+};
+
+/// A position compared through a pointer to the element it names, so that
+/// sorting never copies the element itself.
+template <LessComparable T> struct IndirectIndex {
+    const T *elem;
+    size_t index;
+
+    bool operator<(const IndirectIndex &other) const {
+        return *elem < *other.elem;
+    }
+};
+
+} // namespace detail
+
+/**
+ * Stable argsort: returns `perm` such that `arr[perm[0]], arr[perm[1]], ...`
+ * is sorted, with equal elements kept in their original order.
+ *
+ * Only pointer-sized proxies are moved; the elements are compared in place.
+ */
+template <LessComparable T>
+auto argsort(const vector<T> &arr) -> vector<size_t> {
+    vector<detail::IndirectIndex<T>> proxies(arr.size());
+    for (size_t i = 0; i < arr.size(); i++) {
+        proxies[i] = {&arr[i], i};
+    }
+    powersort(proxies);
+    vector<size_t> perm(arr.size());
+    for (size_t i = 0; i < proxies.size(); i++) {
+        perm[i] = proxies[i].index;
+    }
+    return perm;
+}
+
+/**
+ * Stable argsort by an extracted key.
+ *
+ * `key` is called exactly once per element and the resulting (key, index)
+ * pairs are sorted, so large records are neither moved nor re-read during
+ * the sort.
+ */
+template <typename T, typename KeyFn>
+    requires LessComparable<
+        std::remove_cvref_t<std::invoke_result_t<KeyFn &, const T &>>>
+auto argsort_by_key(const vector<T> &arr, KeyFn key) -> vector<size_t> {
+    using K = std::remove_cvref_t<std::invoke_result_t<KeyFn &, const T &>>;
+    vector<detail::KeyedIndex<K>> keyed;
+    keyed.reserve(arr.size());
+    for (size_t i = 0; i < arr.size(); i++) {
+        keyed.push_back({std::invoke(key, arr[i]), i});
+    }
+    powersort(keyed);
+    vector<size_t> perm(arr.size());
+    for (size_t i = 0; i < keyed.size(); i++) {
+        perm[i] = keyed[i].index;
+    }
+    return perm;
+}
+
+/**
+ * Reorders `arr` in place so that `arr[i]` becomes the old `arr[perm[i]]`.
+ *
+ * The permutation is walked one cycle at a time, so every element is moved
+ * exactly once plus one temporary per cycle, and no second array of `T` is
+ * allocated. `perm` is consumed as the visited marker, hence taken by value.
+ */
+template <typename T>
+auto apply_permutation(vector<T> &arr, vector<size_t> perm)
+    -> std::expected<void, Error> {
+    size_t n = arr.size();
+    if (perm.size() != n) {
+        return std::unexpected<Error>(Error::InvalidArgument(
+            std::format("permutation has {} entries but the array has {}",
+                        perm.size(), n)));
+    }
+    vector<bool> seen(n, false);
+    for (size_t index : perm) {
+        if (index >= n || seen[index]) {
+            return std::unexpected<Error>(Error::InvalidArgument(
+                std::format("not a permutation of 0..{}", n)));
+        }
+        seen[index] = true;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (perm[i] == i) {
+            continue;
+        }
+        T tmp = std::move(arr[i]);
+        size_t j = i;
+        for (;;) {
+            size_t k = perm[j];
+            perm[j] = j;
+            if (k == i) {
+                arr[j] = std::move(tmp);
+                break;
+            }
+            arr[j] = std::move(arr[k]);
+            j = k;
+        }
+    }
+    return {};
+}
+
+/**
+ * Stable sort of `arr` by an extracted key, moving each record only once.
+ */
+template <typename T, typename KeyFn>
+    requires LessComparable<
+        std::remove_cvref_t<std::invoke_result_t<KeyFn &, const T &>>>
+void sort_by_key(vector<T> &arr, KeyFn key) {
+    // A permutation produced by argsort is always valid.
+    (void)apply_permutation(arr, argsort_by_key(arr, std::move(key)));
+}
+
+/**
+ * Sorts `keys` and reorders `values` along with them (structure-of-arrays
+ * layout), stably. Both arrays are reordered by cycle-following, so payloads
+ * are never compared and each one is moved once.
+ */
+template <LessComparable K, typename V>
+auto sort_paired(vector<K> &keys, vector<V> &values)
+    -> std::expected<void, Error> {
+    if (keys.size() != values.size()) {
+        return std::unexpected<Error>(Error::InvalidArgument(
+            std::format("{} keys but {} values", keys.size(), values.size())));
+    }
+    vector<size_t> perm = argsort(keys);
+    auto result = apply_permutation(values, perm);
+    if (!result) {
+        return result;
+    }
+    return apply_permutation(keys, std::move(perm));
+}
+
+#endif // ARGSORT_HPP
@@ -10,6 +10,9 @@
 #include <utility>
 #include <vector>
 
+#include "chapter2/merge_kernel.hpp"
+#include "tuning.hpp"
+
 using std::vector;
 
 template <typename T>
@@ -53,6 +56,39 @@ template <LessComparable T> void insertion_sort(vector<T> &arr) {
     }
 }
 
+/**
+ * Binary insertion sort on the range `arr[lo:hi)`, assuming the prefix
+ * `arr[lo:start)` is already sorted (exercise 2.3-6).
+ *
+ * The insertion point is found by binary search, so only O(log n) comparisons
+ * are spent per element. Equal keys are inserted after existing ones, which
+ * keeps the sort stable.
+ */
+template <LessComparable T>
+void binary_insertion_sort_helper(vector<T> &arr, size_t lo, size_t hi,
+                                  size_t start) {
+    if (start <= lo) {
+        start = lo + 1;
+    }
+    for (size_t i = start; i < hi; i++) {
+        auto first = arr.begin() + lo;
+        auto last = arr.begin() + i;
+        auto pos = std::upper_bound(first, last, arr[i]);
+        if (pos != last) {
+            T key = std::move(arr[i]);
+            std::move_backward(pos, last, last + 1);
+            *pos = std::move(key);
+        }
+    }
+}
+
+/**
+ * Binary insertion sort implementation.
+ */
+template <LessComparable T> void binary_insertion_sort(vector<T> &arr) {
+    binary_insertion_sort_helper(arr, 0, arr.size(), 1);
+}
+
 /**
  * ```
  * BEGIN A[1:n]
@@ -109,8 +145,24 @@ template <LessComparable T> void selection_sort(vector<T> &arr) {
     }
 }
 
+template <typename T>
+    requires requires(const T &a, const T &b) {
+        { a <= b } -> std::convertible_to<bool>;
+    }
+void merge_sort_helper(vector<T> &arr, size_t p, size_t r,
+                       size_t cutoff = tuning().merge_sort_cutoff);
+
+template <typename T>
+    requires requires(T a, T b) {
+        { a > b } -> std::convertible_to<bool>;
+    }
+void recursive_insertion_sort_helper(vector<T> &arr, size_t n);
+
 /**
  * Merge sort auxiliary function.
+ *
+ * Arithmetic keys go through `merge_kernel` (branchless, or SIMD where
+ * available) instead of the element-by-element loop.
  */
 template <typename T>
     requires requires(const T &a, const T &b) {
@@ -119,6 +171,14 @@ template <typename T>
 void merge(vector<T> &arr, size_t p, size_t q, size_t r) {
     // p..<q
     // q..<r
+    if constexpr (MergeKernelKey<T>) {
+        // Only the left half needs a copy: the kernel writes A[p:r) from the
+        // front, never ahead of the unread part of the right half.
+        vector<T> left_arr(arr.begin() + p, arr.begin() + q);
+        merge_kernel(left_arr.data(), q - p, arr.data() + q, r - q,
+                     arr.data() + p);
+        return;
+    }
     size_t left_length = q - p;
     size_t right_length = r - q;
     vector<T> left_arr(left_length);
@@ -221,18 +281,30 @@ void merge_sort(vector<T> &arr) {
 
 /**
  * Merge sort helper function
+ *
+ * Ranges of at most `cutoff` elements are finished by insertion sort
+ * (problem 2-1), which beats merging on short ranges.
  */
 template <typename T>
     requires requires(const T &a, const T &b) {
         { a <= b } -> std::convertible_to<bool>;
     }
-void merge_sort_helper(vector<T> &arr, size_t p, size_t r) {
-    if (r - p <= 1) {
+void merge_sort_helper(vector<T> &arr, size_t p, size_t r, size_t cutoff) {
+    if (r - p <= std::max<size_t>(cutoff, 1)) {
+        for (size_t i = p + 1; i < r; i++) {
+            T key = std::move(arr[i]);
+            size_t j = i;
+            while (j > p && !(arr[j - 1] <= key)) {
+                arr[j] = std::move(arr[j - 1]);
+                j--;
+            }
+            arr[j] = std::move(key);
+        }
         return;
     }
     size_t q = (p + r) / 2;
-    merge_sort_helper(arr, p, q);
-    merge_sort_helper(arr, q, r);
+    merge_sort_helper(arr, p, q, cutoff);
+    merge_sort_helper(arr, q, r, cutoff);
     merge(arr, p, q, r);
 }
 
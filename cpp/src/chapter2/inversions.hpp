@@ -0,0 +1,219 @@
+// Inversion counting (problem 2-4) and Kendall tau distance.
+
+#ifndef INVERSIONS_HPP
+#define INVERSIONS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <utility>
+#include <vector>
+
+#include "chapter2.hpp"
+#include "chapter2/argsort.hpp"
+#include "chapter2/merge_kernel.hpp"
+#include "error.hpp"
+#include "parallel.hpp"
+#include "tuning.hpp"
+
+using std::vector;
+
+namespace detail {
+
+/**
+ * MERGE that also counts inversions: merges the sorted halves `src[p:q)` and
+ * `src[q:r)` into `dst[p:r)` and returns the number of pairs (i, j) with
+ * i in the left half, j in the right half and `src[j] < src[i]`.
+ *
+ * Whenever a right element is taken, every left element not yet taken is
+ * greater than it and forms an inversion with it.
+ */
+template <LessComparable T>
+auto merge_count(const T *src, T *dst, size_t p, size_t q, size_t r)
+    -> uint64_t {
+    uint64_t count = 0;
+    size_t i = p, j = q, k = p;
+    if constexpr (MergeKernelKey<T>) {
+        // Same loop with the branch replaced by selects, as in
+        // `detail::merge_branchless`.
+        while (i < q && j < r) {
+            T x = src[i];
+            T y = src[j];
+            bool take_right = y < x;
+            count += take_right ? q - i : 0;
+            dst[k++] = take_right ? y : x;
+            i += !take_right;
+            j += take_right;
+        }
+    }
+    while (i < q && j < r) {
+        if (src[j] < src[i]) {
+            count += q - i;
+            dst[k++] = src[j++];
+        } else {
+            dst[k++] = src[i++];
+        }
+    }
+    std::copy(src + i, src + q, dst + k);
+    std::copy(src + j, src + r, dst + k + (q - i));
+    return count;
+}
+
+/**
+ * Sorts `a[p:r)` and returns its inversion count. `b[p:r)` holds the same
+ * data on entry and is used as scratch; the two buffers swap roles at every
+ * level, so no copies are made besides the merges themselves.
+ */
+template <LessComparable T>
+auto count_inversions_helper(T *a, T *b, size_t p, size_t r, bool parallel)
+    -> uint64_t {
+    if (r - p <= 1) {
+        return 0;
+    }
+    size_t q = p + (r - p) / 2;
+    uint64_t left = 0;
+    uint64_t right = 0;
+    if (parallel && r - p >= tuning().inversions_parallel_cutoff) {
+        TaskGroup group;
+        group.spawn(
+            [=, &left] { left = count_inversions_helper(b, a, p, q, true); });
+        right = count_inversions_helper(b, a, q, r, true);
+        group.sync();
+    } else {
+        left = count_inversions_helper(b, a, p, q, parallel);
+        right = count_inversions_helper(b, a, q, r, parallel);
+    }
+    return left + right + merge_count(b, a, p, q, r);
+}
+
+} // namespace detail
+
+/**
+ * Number of inversions of `arr`, i.e. pairs i < j with `arr[j] < arr[i]`
+ * (problem 2-4), computed by merge sort in O(n log n).
+ *
+ * Counts are 64-bit, so inputs of 10^9 elements (up to ~5 * 10^17
+ * inversions) are fine. `arr` is taken by value and sorted as a side effect.
+ */
+template <LessComparable T> auto count_inversions(vector<T> arr) -> uint64_t {
+    vector<T> scratch = arr;
+    return detail::count_inversions_helper(arr.data(), scratch.data(), 0,
+                                           arr.size(), false);
+}
+
+/**
+ * Same as `count_inversions`, but the two halves of every range of at least
+ * `tuning().inversions_parallel_cutoff` elements are forked onto the default
+ * pool.
+ */
+template <LessComparable T>
+auto parallel_count_inversions(vector<T> arr) -> uint64_t {
+    vector<T> scratch = arr;
+    return detail::count_inversions_helper(arr.data(), scratch.data(), 0,
+                                           arr.size(), true);
+}
+
+/**
+ * Kendall tau distance between two rankings of the same n items: the number
+ * of item pairs that the rankings order differently.
+ *
+ * `a[i]` and `b[i]` are the scores (or ranks) item i receives in each
+ * ranking. Items are ordered by `a` (ties broken by `b`, so tied pairs are
+ * not counted), and the distance is the inversion count of the resulting
+ * sequence of `b` scores.
+ */
+template <LessComparable T>
+auto kendall_tau_distance(const vector<T> &a, const vector<T> &b)
+    -> std::expected<uint64_t, Error> {
+    if (a.size() != b.size()) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "rankings have different lengths: {} and {}", a.size(), b.size())));
+    }
+    vector<size_t> by_b = argsort(b);
+    vector<size_t> order(by_b.size());
+    {
+        // Stable sort of the b-order by a gives (a, b) lexicographic order.
+        vector<T> a_in_b_order(a.size());
+        for (size_t i = 0; i < by_b.size(); i++) {
+            a_in_b_order[i] = a[by_b[i]];
+        }
+        vector<size_t> perm = argsort(a_in_b_order);
+        for (size_t i = 0; i < perm.size(); i++) {
+            order[i] = by_b[perm[i]];
+        }
+    }
+    vector<T> seq(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        seq[i] = b[order[i]];
+    }
+    return parallel_count_inversions(std::move(seq));
+}
+
+/**
+ * Fenwick tree (binary indexed tree) of 64-bit counts over [0, size).
+ */
+class FenwickTree {
+  private:
+    vector<uint64_t> m_tree;
+
+  public:
+    explicit FenwickTree(size_t size) : m_tree(size + 1, 0) {}
+
+    [[nodiscard]] size_t size() const noexcept { return m_tree.size() - 1; }
+
+    /// Adds `delta` at position `index`.
+    void add(size_t index, uint64_t delta) noexcept {
+        for (size_t i = index + 1; i < m_tree.size(); i += i & (~i + 1)) {
+            m_tree[i] += delta;
+        }
+    }
+
+    /// Sum of positions [0, end).
+    [[nodiscard]] uint64_t prefix_sum(size_t end) const noexcept {
+        uint64_t sum = 0;
+        for (size_t i = std::min(end, size()); i > 0; i -= i & (~i + 1)) {
+            sum += m_tree[i];
+        }
+        return sum;
+    }
+};
+
+/**
+ * Incremental inversion counter for a stream of integer values in
+ * [0, universe).
+ *
+ * Each `push` adds the number of earlier values greater than the new one,
+ * found with one Fenwick-tree query, so the stream never has to be stored
+ * or sorted: O(log universe) per element and O(universe) memory.
+ */
+class StreamingInversionCounter {
+  private:
+    FenwickTree m_seen;
+    uint64_t m_count = 0;
+    uint64_t m_inversions = 0;
+
+  public:
+    explicit StreamingInversionCounter(size_t universe) : m_seen(universe) {}
+
+    /**
+     * @brief Appends `value` to the stream
+     * @return An error if `value` is outside [0, universe)
+     */
+    auto push(size_t value) -> std::expected<void, Error> {
+        if (value >= m_seen.size()) {
+            return std::unexpected<Error>(Error::InvalidArgument(
+                std::format("value {} outside the universe [0, {})", value,
+                            m_seen.size())));
+        }
+        m_inversions += m_count - m_seen.prefix_sum(value + 1);
+        m_seen.add(value, 1);
+        m_count++;
+        return {};
+    }
+
+    [[nodiscard]] uint64_t count() const noexcept { return m_count; }
+    [[nodiscard]] uint64_t inversions() const noexcept { return m_inversions; }
+};
+
+#endif // INVERSIONS_HPP
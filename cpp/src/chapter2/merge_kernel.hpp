@@ -0,0 +1,249 @@
+// Branchless and SIMD merge kernels for arithmetic keys.
+
+#ifndef MERGE_KERNEL_HPP
+#define MERGE_KERNEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/// Keys the merge kernels handle: plain numbers, compared with `<` and
+/// copied freely, so a selection can replace a branch.
+template <typename T>
+concept MergeKernelKey = std::is_arithmetic_v<T>;
+
+namespace detail {
+
+/**
+ * Stable merge with the data-dependent branch replaced by selects: each
+ * step computes which side wins and advances both indices arithmetically,
+ * which compiles to conditional moves. The only branch left is the loop
+ * bound, which is predicted correctly until the end.
+ */
+template <MergeKernelKey T>
+void merge_branchless(const T *a, size_t na, const T *b, size_t nb, T *out) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t k = 0;
+    while (i < na && j < nb) {
+        T x = a[i];
+        T y = b[j];
+        bool take_b = y < x;
+        out[k++] = take_b ? y : x;
+        i += !take_b;
+        j += take_b;
+    }
+    std::copy(a + i, a + na, out + k);
+    k += na - i;
+    if (out + k != b + j) {
+        std::copy(b + j, b + nb, out + k);
+    }
+}
+
+#if defined(__AVX2__)
+
+/**
+ * One AVX2 register of keys and the network sorting a bitonic register:
+ * compare-exchanges at distance WIDTH / 2, ..., 1, each one permute, a min,
+ * a max and a blend.
+ *
+ * Every lane must keep one of its two inputs, or keys that compare equal
+ * but differ (-0.0 and 0.0) would be duplicated. `min` and `max` return
+ * their first operand on a tie, which is the lane's own key in
+ * `sort_bitonic`; `exchange` orders two registers lane by lane from a single
+ * comparison. The integer min and max instructions are exact, the
+ * floating-point ones are not, so those are built from a compare and a
+ * blend.
+ */
+template <typename T> struct BitonicRegister;
+
+template <> struct BitonicRegister<int32_t> {
+    using V = __m256i;
+    static constexpr size_t WIDTH = 8;
+
+    static V load(const int32_t *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+    static void store(int32_t *p, V v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+    }
+    static V min(V a, V b) { return _mm256_min_epi32(a, b); }
+    static V max(V a, V b) { return _mm256_max_epi32(a, b); }
+    static void exchange(V &lo, V &hi) {
+        V l = min(lo, hi);
+        hi = max(lo, hi);
+        lo = l;
+    }
+    static V reverse(V v) {
+        return _mm256_permutevar8x32_epi32(
+            v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    }
+    static V sort_bitonic(V v) {
+        V t = _mm256_permute2x128_si256(v, v, 1);
+        v = _mm256_blend_epi32(min(v, t), max(v, t), 0xf0);
+        t = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+        v = _mm256_blend_epi32(min(v, t), max(v, t), 0xcc);
+        t = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm256_blend_epi32(min(v, t), max(v, t), 0xaa);
+    }
+};
+
+template <> struct BitonicRegister<float> {
+    using V = __m256;
+    static constexpr size_t WIDTH = 8;
+
+    static V load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, V v) { _mm256_storeu_ps(p, v); }
+    static V min(V a, V b) {
+        return _mm256_blendv_ps(a, b, _mm256_cmp_ps(b, a, _CMP_LT_OQ));
+    }
+    static V max(V a, V b) {
+        return _mm256_blendv_ps(a, b, _mm256_cmp_ps(a, b, _CMP_LT_OQ));
+    }
+    static void exchange(V &lo, V &hi) {
+        V swap = _mm256_cmp_ps(hi, lo, _CMP_LT_OQ);
+        V l = _mm256_blendv_ps(lo, hi, swap);
+        hi = _mm256_blendv_ps(hi, lo, swap);
+        lo = l;
+    }
+    static V reverse(V v) {
+        return _mm256_permutevar8x32_ps(
+            v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    }
+    static V sort_bitonic(V v) {
+        V t = _mm256_permute2f128_ps(v, v, 1);
+        v = _mm256_blend_ps(min(v, t), max(v, t), 0xf0);
+        t = _mm256_permute_ps(v, _MM_SHUFFLE(1, 0, 3, 2));
+        v = _mm256_blend_ps(min(v, t), max(v, t), 0xcc);
+        t = _mm256_permute_ps(v, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm256_blend_ps(min(v, t), max(v, t), 0xaa);
+    }
+};
+
+template <> struct BitonicRegister<double> {
+    using V = __m256d;
+    static constexpr size_t WIDTH = 4;
+
+    static V load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, V v) { _mm256_storeu_pd(p, v); }
+    static V min(V a, V b) {
+        return _mm256_blendv_pd(a, b, _mm256_cmp_pd(b, a, _CMP_LT_OQ));
+    }
+    static V max(V a, V b) {
+        return _mm256_blendv_pd(a, b, _mm256_cmp_pd(a, b, _CMP_LT_OQ));
+    }
+    static void exchange(V &lo, V &hi) {
+        V swap = _mm256_cmp_pd(hi, lo, _CMP_LT_OQ);
+        V l = _mm256_blendv_pd(lo, hi, swap);
+        hi = _mm256_blendv_pd(hi, lo, swap);
+        lo = l;
+    }
+    static V reverse(V v) {
+        return _mm256_permute4x64_pd(v, _MM_SHUFFLE(0, 1, 2, 3));
+    }
+    static V sort_bitonic(V v) {
+        V t = _mm256_permute2f128_pd(v, v, 1);
+        v = _mm256_blend_pd(min(v, t), max(v, t), 0xc);
+        t = _mm256_permute_pd(v, 0x5);
+        return _mm256_blend_pd(min(v, t), max(v, t), 0xa);
+    }
+};
+
+template <typename T>
+concept HasBitonicRegister = requires { BitonicRegister<T>::WIDTH; };
+
+/**
+ * Merges two sorted registers: `lo` receives the WIDTH smallest keys and
+ * `hi` the WIDTH largest, both sorted. `lo` followed by `hi` reversed is
+ * bitonic, so one min/max splits it into two bitonic halves with every key
+ * of the first <= every key of the second, which are then sorted.
+ */
+template <typename R>
+void bitonic_merge(typename R::V &lo, typename R::V &hi) {
+    typename R::V reversed = R::reverse(hi);
+    R::exchange(lo, reversed);
+    lo = R::sort_bitonic(lo);
+    hi = R::sort_bitonic(reversed);
+}
+
+/**
+ * Merge that emits WIDTH keys per step: the register `hi` carries the
+ * largest keys merged so far, the next block is loaded from whichever input
+ * has the smaller head, and one `bitonic_merge` releases the WIDTH smallest
+ * of both. When an input has less than a block left, the carried keys and
+ * that input's tail are merged into a small buffer, which is then merged
+ * with the other tail.
+ */
+template <MergeKernelKey T>
+    requires HasBitonicRegister<T>
+void merge_simd(const T *a, size_t na, const T *b, size_t nb, T *out) {
+    using R = BitonicRegister<T>;
+    constexpr size_t W = R::WIDTH;
+    if (na < W || nb < W) {
+        merge_branchless(a, na, b, nb, out);
+        return;
+    }
+    typename R::V lo = R::load(a);
+    typename R::V hi = R::load(b);
+    size_t i = W;
+    size_t j = W;
+    size_t k = 0;
+    bitonic_merge<R>(lo, hi);
+    R::store(out, lo);
+    k += W;
+    while (i + W <= na && j + W <= nb) {
+        bool take_a = !(b[j] < a[i]);
+        const T *next = take_a ? a + i : b + j;
+        i += take_a ? W : 0;
+        j += take_a ? 0 : W;
+        lo = R::load(next);
+        bitonic_merge<R>(lo, hi);
+        R::store(out + k, lo);
+        k += W;
+    }
+
+    alignas(32) T carried[W];
+    R::store(carried, hi);
+    T tail[2 * W];
+    if (na - i < W) {
+        merge_branchless(carried, W, a + i, na - i, tail);
+        merge_simd(tail, W + na - i, b + j, nb - j, out + k);
+    } else {
+        merge_branchless(carried, W, b + j, nb - j, tail);
+        merge_simd(a + i, na - i, tail, W + nb - j, out + k);
+    }
+}
+
+#endif
+
+} // namespace detail
+
+/**
+ * Merges the sorted ranges `a[0:na)` and `b[0:nb)` into `out`.
+ *
+ * int32, float and double take the AVX2 bitonic path when it is available,
+ * 8 (4 for double) keys per step; other arithmetic types and other targets
+ * use the branchless scalar merge. The scalar merge is stable; on the SIMD
+ * path equal keys are interchangeable, so -0.0 and 0.0 may come out in
+ * either order, but every input key appears exactly once in `out`.
+ *
+ * `out` must not overlap `a`. It may overlap `b` only as `out + na == b`,
+ * the layout of an in-place merge whose left run was copied to a buffer.
+ */
+template <MergeKernelKey T>
+void merge_kernel(const T *a, size_t na, const T *b, size_t nb, T *out) {
+#if defined(__AVX2__)
+    if constexpr (detail::HasBitonicRegister<T>) {
+        detail::merge_simd(a, na, b, nb, out);
+        return;
+    }
+#endif
+    detail::merge_branchless(a, na, b, nb, out);
+}
+
+#endif // MERGE_KERNEL_HPP
@@ -0,0 +1,383 @@
+// Pair-sum queries (exercise 2.3-8) over a fixed array.
+
+#ifndef PAIR_SUM_HPP
+#define PAIR_SUM_HPP
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "chapter2.hpp"
+#include "chapter2/argsort.hpp"
+#include "parallel.hpp"
+
+using std::vector;
+
+/// Slots compared at once when probing the hash backend.
+inline constexpr size_t PAIR_SUM_PROBE_GROUP = 8;
+
+/**
+ * @brief How a PairSumIndex answers queries
+ */
+enum class PairSumBackend {
+    /// Values sorted once; each query is a two-pointer scan, O(n).
+    Sorted,
+    /// Distinct values in an open-addressing table; each query looks up
+    /// the complement of every distinct value, O(distinct) expected.
+    Hashed,
+};
+
+/**
+ * @brief Answers "which two elements sum to x?" for many x over one array
+ *
+ * Exercise 2.3-8: a pair is two distinct positions i < j with
+ * `arr[i] + arr[j] == x`. Sums are formed in a wider type, so they never
+ * overflow. The index copies what it needs; the array may change or go
+ * away afterwards.
+ */
+template <std::integral T> class PairSumIndex {
+  private:
+    using Wide = std::conditional_t<(sizeof(T) < sizeof(int64_t)), int64_t,
+                                    __int128>;
+    static constexpr size_t EMPTY = std::numeric_limits<size_t>::max();
+
+    PairSumBackend m_backend;
+    size_t m_size;
+
+    // Sorted backend: the values in order and where each came from.
+    vector<T> m_sorted;
+    vector<size_t> m_order;
+
+    // Hashed backend: distinct values with their multiplicities, positions
+    // grouped by value (value d owns m_positions[m_offsets[d]:
+    // m_offsets[d + 1])), and a linear-probing table from value to d. The
+    // table carries PAIR_SUM_PROBE_GROUP extra slots mirroring its start, so
+    // a probe group never wraps.
+    vector<T> m_values;
+    vector<size_t> m_offsets;
+    vector<size_t> m_positions;
+    vector<T> m_keys;
+    vector<size_t> m_slots;
+    int m_shift = 64;
+
+    [[nodiscard]] size_t home(T value) const {
+        auto bits = static_cast<uint64_t>(value);
+        return static_cast<size_t>((bits * 0x9e3779b97f4a7c15ULL) >> m_shift);
+    }
+
+    /// Complement x - v if it is representable in T.
+    static bool complement(Wide x, T v, T &out) {
+        Wide c = x - static_cast<Wide>(v);
+        if (c < static_cast<Wide>(std::numeric_limits<T>::min()) ||
+            c > static_cast<Wide>(std::numeric_limits<T>::max())) {
+            return false;
+        }
+        out = static_cast<T>(c);
+        return true;
+    }
+
+    /**
+     * Id of `value` among the distinct values, or EMPTY. A whole group of
+     * slots is compared per step: the fixed-length loops build a bitmask of
+     * matching and of empty slots and compile to vector compares.
+     */
+    [[nodiscard]] size_t find(T value) const {
+        size_t mask = m_keys.size() - PAIR_SUM_PROBE_GROUP - 1;
+        size_t s = home(value);
+        for (;;) {
+            uint32_t match = 0;
+            uint32_t empty = 0;
+            for (size_t l = 0; l < PAIR_SUM_PROBE_GROUP; l++) {
+                bool used = m_slots[s + l] != EMPTY;
+                match |= static_cast<uint32_t>(used && m_keys[s + l] == value)
+                         << l;
+                empty |= static_cast<uint32_t>(!used) << l;
+            }
+            // Linear probing: only matches before the first empty slot count.
+            uint32_t before_empty =
+                empty == 0 ? match : match & ((empty & -empty) - 1);
+            if (before_empty != 0) {
+                return m_slots[s + std::countr_zero(before_empty)];
+            }
+            if (empty != 0) {
+                return EMPTY;
+            }
+            s = (s + PAIR_SUM_PROBE_GROUP) & mask;
+        }
+    }
+
+    void build_sorted(const vector<T> &arr) {
+        m_order = argsort(arr);
+        m_sorted.resize(arr.size());
+        for (size_t i = 0; i < arr.size(); i++) {
+            m_sorted[i] = arr[m_order[i]];
+        }
+    }
+
+    void build_hashed(const vector<T> &arr) {
+        size_t capacity = std::bit_ceil(std::max<size_t>(16, 2 * arr.size()));
+        m_shift = 64 - std::countr_zero(capacity);
+        m_keys.assign(capacity + PAIR_SUM_PROBE_GROUP, T{});
+        m_slots.assign(capacity + PAIR_SUM_PROBE_GROUP, EMPTY);
+        vector<size_t> ids(arr.size());
+        vector<size_t> counts;
+        for (size_t i = 0; i < arr.size(); i++) {
+            size_t id = find(arr[i]);
+            if (id == EMPTY) {
+                id = m_values.size();
+                m_values.push_back(arr[i]);
+                counts.push_back(0);
+                size_t s = home(arr[i]);
+                while (m_slots[s] != EMPTY) {
+                    s = (s + 1) & (capacity - 1);
+                }
+                m_keys[s] = arr[i];
+                m_slots[s] = id;
+                if (s < PAIR_SUM_PROBE_GROUP) {
+                    m_keys[capacity + s] = arr[i];
+                    m_slots[capacity + s] = id;
+                }
+            }
+            ids[i] = id;
+            counts[id]++;
+        }
+        m_offsets.assign(m_values.size() + 1, 0);
+        for (size_t d = 0; d < m_values.size(); d++) {
+            m_offsets[d + 1] = m_offsets[d] + counts[d];
+        }
+        m_positions.resize(arr.size());
+        vector<size_t> next(m_offsets.begin(), m_offsets.end() - 1);
+        for (size_t i = 0; i < arr.size(); i++) {
+            m_positions[next[ids[i]]++] = i;
+        }
+    }
+
+    [[nodiscard]] size_t multiplicity(size_t d) const {
+        return m_offsets[d + 1] - m_offsets[d];
+    }
+
+    /**
+     * Walks every matching group of values for target `x`: calls
+     * `same(d)` when value d pairs with itself and `cross(d, e)` when
+     * distinct values d and e pair. Stops early once a callback returns
+     * true.
+     */
+    template <typename Same, typename Cross>
+    void for_each_match_hashed(T x, Same &&same, Cross &&cross) const {
+        for (size_t d = 0; d < m_values.size(); d++) {
+            T v = m_values[d];
+            T c;
+            if (!complement(x, v, c) || c < v) {
+                continue;
+            }
+            size_t e = c == v ? d : find(c);
+            if (e == EMPTY) {
+                continue;
+            }
+            if (e == d) {
+                if (multiplicity(d) >= 2 && same(d)) {
+                    return;
+                }
+            } else if (cross(d, e)) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * Two-pointer scan of the sorted values for target `x`: calls
+     * `same(lo, hi)` for a block of equal values summing with each other
+     * and `cross(lo, lo_end, hi_begin, hi)` for two blocks of distinct
+     * values. Stops early once a callback returns true.
+     */
+    template <typename Same, typename Cross>
+    void for_each_match_sorted(T x, Same &&same, Cross &&cross) const {
+        if (m_size < 2) {
+            return;
+        }
+        size_t lo = 0;
+        size_t hi = m_size - 1;
+        auto target = static_cast<Wide>(x);
+        while (lo < hi) {
+            Wide sum = static_cast<Wide>(m_sorted[lo]) +
+                       static_cast<Wide>(m_sorted[hi]);
+            if (sum < target) {
+                lo++;
+            } else if (sum > target) {
+                hi--;
+            } else if (m_sorted[lo] == m_sorted[hi]) {
+                same(lo, hi + 1);
+                return;
+            } else {
+                size_t lo_end = lo + 1;
+                while (m_sorted[lo_end] == m_sorted[lo]) {
+                    lo_end++;
+                }
+                size_t hi_begin = hi;
+                while (m_sorted[hi_begin - 1] == m_sorted[hi]) {
+                    hi_begin--;
+                }
+                if (cross(lo, lo_end, hi_begin, hi + 1)) {
+                    return;
+                }
+                lo = lo_end;
+                hi = hi_begin - 1;
+            }
+        }
+    }
+
+    /// Runs `query(x)` for every target, spread over the default pool.
+    template <typename R, typename F>
+    auto batch(std::span<const T> targets, F &&query) const -> vector<R> {
+        vector<R> out(targets.size());
+        parallel_for(0, targets.size(), 0, [&](size_t lo, size_t hi) {
+            for (size_t q = lo; q < hi; q++) {
+                out[q] = query(targets[q]);
+            }
+        });
+        return out;
+    }
+
+  public:
+    /**
+     * @brief Builds the index over `arr` with the chosen backend
+     */
+    explicit PairSumIndex(const vector<T> &arr,
+                          PairSumBackend backend = PairSumBackend::Sorted)
+        : m_backend(backend), m_size(arr.size()) {
+        if (backend == PairSumBackend::Sorted) {
+            build_sorted(arr);
+        } else {
+            build_hashed(arr);
+        }
+    }
+
+    [[nodiscard]] PairSumBackend backend() const noexcept { return m_backend; }
+    [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+    /// Whether two elements sum to `x`.
+    [[nodiscard]] bool contains(T x) const {
+        bool found = false;
+        auto hit = [&](auto...) { return found = true; };
+        if (m_backend == PairSumBackend::Sorted) {
+            for_each_match_sorted(x, hit, hit);
+        } else {
+            for_each_match_hashed(x, hit, hit);
+        }
+        return found;
+    }
+
+    /// Number of pairs of positions whose elements sum to `x`.
+    [[nodiscard]] uint64_t count(T x) const {
+        uint64_t total = 0;
+        auto choose2 = [](uint64_t m) { return m * (m - 1) / 2; };
+        if (m_backend == PairSumBackend::Sorted) {
+            for_each_match_sorted(
+                x,
+                [&](size_t lo, size_t hi) {
+                    total += choose2(hi - lo);
+                    return false;
+                },
+                [&](size_t lo, size_t lo_end, size_t hi_begin, size_t hi) {
+                    total += uint64_t{lo_end - lo} * (hi - hi_begin);
+                    return false;
+                });
+        } else {
+            for_each_match_hashed(
+                x,
+                [&](size_t d) {
+                    total += choose2(multiplicity(d));
+                    return false;
+                },
+                [&](size_t d, size_t e) {
+                    total += uint64_t{multiplicity(d)} * multiplicity(e);
+                    return false;
+                });
+        }
+        return total;
+    }
+
+    /**
+     * @brief Every pair of positions (i, j), i < j, whose elements sum to
+     * `x`, in lexicographic order
+     */
+    [[nodiscard]] auto pairs(T x) const -> vector<std::pair<size_t, size_t>> {
+        vector<std::pair<size_t, size_t>> out;
+        auto add = [&out](size_t i, size_t j) {
+            out.emplace_back(std::min(i, j), std::max(i, j));
+        };
+        if (m_backend == PairSumBackend::Sorted) {
+            for_each_match_sorted(
+                x,
+                [&](size_t lo, size_t hi) {
+                    for (size_t a = lo; a < hi; a++) {
+                        for (size_t b = a + 1; b < hi; b++) {
+                            add(m_order[a], m_order[b]);
+                        }
+                    }
+                    return false;
+                },
+                [&](size_t lo, size_t lo_end, size_t hi_begin, size_t hi) {
+                    for (size_t a = lo; a < lo_end; a++) {
+                        for (size_t b = hi_begin; b < hi; b++) {
+                            add(m_order[a], m_order[b]);
+                        }
+                    }
+                    return false;
+                });
+        } else {
+            for_each_match_hashed(
+                x,
+                [&](size_t d) {
+                    for (size_t a = m_offsets[d]; a < m_offsets[d + 1]; a++) {
+                        for (size_t b = a + 1; b < m_offsets[d + 1]; b++) {
+                            add(m_positions[a], m_positions[b]);
+                        }
+                    }
+                    return false;
+                },
+                [&](size_t d, size_t e) {
+                    for (size_t a = m_offsets[d]; a < m_offsets[d + 1]; a++) {
+                        for (size_t b = m_offsets[e]; b < m_offsets[e + 1];
+                             b++) {
+                            add(m_positions[a], m_positions[b]);
+                        }
+                    }
+                    return false;
+                });
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    /// `contains` for every target, answered in parallel.
+    [[nodiscard]] auto contains(std::span<const T> targets) const
+        -> vector<bool> {
+        auto found = batch<uint8_t>(targets, [this](T x) {
+            return static_cast<uint8_t>(contains(x));
+        });
+        return vector<bool>(found.begin(), found.end());
+    }
+
+    /// `count` for every target, answered in parallel.
+    [[nodiscard]] auto count(std::span<const T> targets) const
+        -> vector<uint64_t> {
+        return batch<uint64_t>(targets, [this](T x) { return count(x); });
+    }
+};
+
+/**
+ * Exercise 2.3-8: whether two elements of `arr` sum to `x`, by sorting and a
+ * two-pointer scan, Θ(n lg n).
+ */
+template <std::integral T> bool has_pair_with_sum(const vector<T> &arr, T x) {
+    return PairSumIndex<T>(arr, PairSumBackend::Sorted).contains(x);
+}
+
+#endif // PAIR_SUM_HPP
@@ -0,0 +1,300 @@
+// Run-adaptive natural merge sort (powersort).
+
+#ifndef POWERSORT_HPP
+#define POWERSORT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "chapter2.hpp"
+#include "chapter2/merge_kernel.hpp"
+
+using std::vector;
+
+namespace detail {
+
+/// Consecutive wins after which a merge switches to galloping mode.
+inline constexpr size_t MIN_GALLOP = 7;
+
+/// A maximal sorted run `arr[begin:begin + length)` waiting to be merged.
+struct PendingRun {
+    size_t begin;
+    size_t length;
+    unsigned power;
+};
+
+/**
+ * Minimum run length for an input of `n` elements.
+ *
+ * Returns a value in [32, 64] such that n / min_run is close to, but not
+ * greater than, a power of two, which keeps the final merges balanced.
+ */
+inline auto powersort_min_run(size_t n) -> size_t {
+    size_t r = 0;
+    while (n >= 64) {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+/**
+ * Length of the run starting at `arr[lo]`, never reaching past `hi`.
+ *
+ * A strictly descending run is reversed in place so that every returned run
+ * is ascending. Descending runs must be strict to keep the sort stable.
+ */
+template <LessComparable T>
+auto count_run_and_make_ascending(vector<T> &arr, size_t lo, size_t hi)
+    -> size_t {
+    size_t i = lo + 1;
+    if (i == hi) {
+        return 1;
+    }
+    if (arr[i] < arr[lo]) {
+        while (i + 1 < hi && arr[i + 1] < arr[i]) {
+            i++;
+        }
+        std::reverse(arr.begin() + lo, arr.begin() + i + 1);
+    } else {
+        while (i + 1 < hi && !(arr[i + 1] < arr[i])) {
+            i++;
+        }
+    }
+    return i + 1 - lo;
+}
+
+/**
+ * Node power of the boundary between the adjacent runs
+ * `[s1, s1 + n1)` and `[s1 + n1, s1 + n1 + n2)` in an array of length `n`.
+ *
+ * It is the depth at which the midpoints of both runs are separated in the
+ * perfectly balanced merge tree over [0, n), computed bit by bit on the
+ * scaled midpoints to avoid floating point.
+ */
+inline auto node_power(size_t s1, size_t n1, size_t n2, size_t n) -> unsigned {
+    unsigned result = 0;
+    uint64_t a = 2 * static_cast<uint64_t>(s1) + n1;
+    uint64_t b = a + n1 + n2;
+    for (;;) {
+        ++result;
+        if (a >= n) {
+            a -= n;
+            b -= n;
+        } else if (b >= n) {
+            break;
+        }
+        a <<= 1;
+        b <<= 1;
+    }
+    return result;
+}
+
+/**
+ * Number of leading elements of `base[0:len)` that are <= `key`, found by
+ * exponential search from the left followed by a binary search.
+ */
+template <LessComparable T>
+auto gallop_right(const T &key, const T *base, size_t len) -> size_t {
+    if (len == 0 || key < base[0]) {
+        return 0;
+    }
+    size_t last = 0;
+    size_t ofs = 1;
+    while (ofs < len && !(key < base[ofs])) {
+        last = ofs;
+        ofs = (ofs << 1) + 1;
+    }
+    ofs = std::min(ofs, len);
+    return std::upper_bound(base + last + 1, base + ofs, key) - base;
+}
+
+/**
+ * Number of leading elements of `base[0:len)` that are < `key`, found by
+ * exponential search from the left followed by a binary search.
+ */
+template <LessComparable T>
+auto gallop_left(const T &key, const T *base, size_t len) -> size_t {
+    if (len == 0 || !(base[0] < key)) {
+        return 0;
+    }
+    size_t last = 0;
+    size_t ofs = 1;
+    while (ofs < len && base[ofs] < key) {
+        last = ofs;
+        ofs = (ofs << 1) + 1;
+    }
+    ofs = std::min(ofs, len);
+    return std::lower_bound(base + last + 1, base + ofs, key) - base;
+}
+
+/**
+ * Merges the adjacent ascending runs `arr[a:a + na)` and
+ * `arr[a + na:a + na + nb)` in place, using `buf` as scratch space.
+ *
+ * Elements of the left run that are already in their final position, and
+ * elements of the right run that are, are skipped by galloping before any
+ * data is moved. Only what remains of the left run is copied to `buf`. While
+ * one side keeps winning, the merge switches to galloping mode and moves
+ * whole blocks at once; `min_gallop` adapts to how well that pays off.
+ */
+template <LessComparable T>
+void merge_runs(vector<T> &arr, size_t a, size_t na, size_t nb, vector<T> &buf,
+                size_t &min_gallop) {
+    T *base = arr.data();
+    size_t b = a + na;
+
+    // Left elements <= arr[b] are already in place.
+    size_t skip = gallop_right(base[b], base + a, na);
+    a += skip;
+    na -= skip;
+    if (na == 0) {
+        return;
+    }
+    // Right elements >= the last left element are already in place.
+    nb = gallop_left(base[a + na - 1], base + b, nb);
+    if (nb == 0) {
+        return;
+    }
+
+    buf.clear();
+    buf.insert(buf.end(), std::make_move_iterator(base + a),
+               std::make_move_iterator(base + b));
+
+    if constexpr (MergeKernelKey<T>) {
+        // Numbers merge faster through the branchless/SIMD kernel than
+        // through the galloping loop below.
+        merge_kernel(buf.data(), na, base + b, nb, base + a);
+        return;
+    }
+
+    T *dest = base + a;
+    T *pa = buf.data();
+    T *pa_end = pa + na;
+    T *pb = base + b;
+    T *pb_end = pb + nb;
+
+    while (pa < pa_end && pb < pb_end) {
+        // One element at a time until one side wins too often in a row.
+        size_t wins_a = 0;
+        size_t wins_b = 0;
+        while (pa < pa_end && pb < pb_end) {
+            if (*pb < *pa) {
+                *dest++ = std::move(*pb++);
+                wins_a = 0;
+                if (++wins_b >= min_gallop) {
+                    break;
+                }
+            } else {
+                *dest++ = std::move(*pa++);
+                wins_b = 0;
+                if (++wins_a >= min_gallop) {
+                    break;
+                }
+            }
+        }
+        if (pa == pa_end || pb == pb_end) {
+            break;
+        }
+
+        // Galloping mode: move whole blocks while it keeps paying off.
+        ++min_gallop;
+        size_t run_a = 0;
+        size_t run_b = 0;
+        do {
+            min_gallop -= min_gallop > 1;
+            run_a = gallop_right(*pb, pa, pa_end - pa);
+            dest = std::move(pa, pa + run_a, dest);
+            pa += run_a;
+            if (pa == pa_end) {
+                break;
+            }
+            *dest++ = std::move(*pb++);
+            if (pb == pb_end) {
+                break;
+            }
+            run_b = gallop_left(*pa, pb, pb_end - pb);
+            dest = std::move(pb, pb + run_b, dest);
+            pb += run_b;
+            if (pb == pb_end) {
+                break;
+            }
+            *dest++ = std::move(*pa++);
+            if (pa == pa_end) {
+                break;
+            }
+        } while (run_a >= MIN_GALLOP || run_b >= MIN_GALLOP);
+        ++min_gallop;
+    }
+
+    // What is left of the right run is already in place.
+    std::move(pa, pa_end, dest);
+}
+
+} // namespace detail
+
+/**
+ * Powersort: a stable, run-adaptive natural merge sort.
+ *
+ * The input is scanned once for maximal ascending or strictly descending
+ * runs; descending runs are reversed and runs shorter than the minimum run
+ * length are extended with `binary_insertion_sort_helper`. Runs are merged
+ * according to the powersort policy, which keeps the merge tree within a
+ * constant of the optimum for the given run lengths, and each merge gallops
+ * over blocks that are already in order.
+ *
+ * An already sorted (or reverse sorted) input costs n - 1 comparisons and no
+ * merges at all; k runs cost O(n log k).
+ */
+template <LessComparable T> void powersort(vector<T> &arr) {
+    size_t n = arr.size();
+    if (n < 2) {
+        return;
+    }
+    size_t min_run = detail::powersort_min_run(n);
+    auto next_run = [&](size_t lo) -> size_t {
+        size_t length = detail::count_run_and_make_ascending(arr, lo, n);
+        if (length < min_run) {
+            size_t forced = std::min(min_run, n - lo);
+            binary_insertion_sort_helper(arr, lo, lo + forced, lo + length);
+            length = forced;
+        }
+        return length;
+    };
+
+    vector<T> buf;
+    size_t min_gallop = detail::MIN_GALLOP;
+    vector<detail::PendingRun> stack;
+    auto merge_top = [&]() {
+        detail::PendingRun right = stack.back();
+        stack.pop_back();
+        detail::PendingRun &left = stack.back();
+        detail::merge_runs(arr, left.begin, left.length, right.length, buf,
+                           min_gallop);
+        left.length += right.length;
+    };
+
+    stack.push_back({0, next_run(0), 0});
+    while (stack.back().begin + stack.back().length < n) {
+        const detail::PendingRun &top = stack.back();
+        size_t next_begin = top.begin + top.length;
+        size_t next_length = next_run(next_begin);
+        unsigned power =
+            detail::node_power(top.begin, top.length, next_length, n);
+        // Powers strictly increase from the bottom of the stack to the top;
+        // merge everything deeper than the new boundary first.
+        while (stack.size() > 1 && stack[stack.size() - 2].power > power) {
+            merge_top();
+        }
+        stack.back().power = power;
+        stack.push_back({next_begin, next_length, 0});
+    }
+    while (stack.size() > 1) {
+        merge_top();
+    }
+}
+
+#endif // POWERSORT_HPP
@@ -0,0 +1,386 @@
+// Order-statistic selection, partial sort and top-k.
+
+#ifndef SELECTION_HPP
+#define SELECTION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "chapter2.hpp"
+#include "chapter2/powersort.hpp"
+#include "chapter2/sorting_network.hpp"
+#include "parallel.hpp"
+#include "tuning.hpp"
+
+using std::vector;
+
+namespace detail {
+
+/// Unbalanced partitions introselect tolerates before switching to
+/// median-of-medians pivots.
+inline constexpr size_t INTROSELECT_BAD_ROUNDS = 8;
+
+/// Sorts `arr[lo:hi)`, using the branch-free small sort when T allows it.
+template <LessComparable T>
+void sort_small_range(vector<T> &arr, size_t lo, size_t hi) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        if (hi - lo <= BITONIC_SORT_MAX) {
+            small_sort(arr.data() + lo, hi - lo);
+            return;
+        }
+    }
+    binary_insertion_sort_helper(arr, lo, hi, lo + 1);
+}
+
+/**
+ * Three-way partition of `arr[lo:hi)` around `pivot`. Returns [lt, gt) such
+ * that `arr[lo:lt)` < pivot, `arr[lt:gt)` == pivot and `arr[gt:hi)` > pivot,
+ * so runs of equal keys never degrade the selection.
+ */
+template <LessComparable T>
+auto partition3(vector<T> &arr, size_t lo, size_t hi, const T &pivot)
+    -> std::pair<size_t, size_t> {
+    size_t lt = lo;
+    size_t i = lo;
+    size_t gt = hi;
+    while (i < gt) {
+        if (arr[i] < pivot) {
+            std::swap(arr[lt++], arr[i++]);
+        } else if (pivot < arr[i]) {
+            std::swap(arr[i], arr[--gt]);
+        } else {
+            i++;
+        }
+    }
+    return {lt, gt};
+}
+
+template <LessComparable T>
+void introselect_helper(vector<T> &arr, size_t lo, size_t hi, size_t k,
+                        size_t budget);
+
+/// Median of the first, middle and last elements of `arr[lo:hi)`.
+template <LessComparable T>
+auto median_of_three(const vector<T> &arr, size_t lo, size_t hi) -> T {
+    const T &a = arr[lo];
+    const T &b = arr[lo + (hi - lo) / 2];
+    const T &c = arr[hi - 1];
+    if (a < b) {
+        return b < c ? b : (a < c ? c : a);
+    }
+    return a < c ? a : (b < c ? c : b);
+}
+
+/**
+ * Median of medians of groups of five in `arr[lo:hi)`. The medians are
+ * gathered at the front of the range and their median is selected
+ * recursively, which guarantees a pivot between the 30th and 70th
+ * percentile.
+ */
+template <LessComparable T>
+auto median_of_medians(vector<T> &arr, size_t lo, size_t hi) -> T {
+    size_t m = lo;
+    for (size_t g = lo; g < hi; g += 5) {
+        size_t end = std::min(g + 5, hi);
+        binary_insertion_sort_helper(arr, g, end, g + 1);
+        std::swap(arr[m++], arr[g + (end - g) / 2]);
+    }
+    size_t mid = lo + (m - lo) / 2;
+    introselect_helper(arr, lo, m, mid, INTROSELECT_BAD_ROUNDS);
+    return arr[mid];
+}
+
+/**
+ * Rearranges `arr[lo:hi)` so that `arr[k]` holds the element of that rank,
+ * with nothing larger before it and nothing smaller after it.
+ *
+ * Quickselect with a median-of-three pivot; after `budget` rounds that keep
+ * more than three quarters of the range it falls back to median-of-medians
+ * pivots. A constant budget bounds the unbalanced rounds at O(n) in total
+ * and every other round shrinks the range geometrically, so the worst case
+ * is O(n).
+ */
+template <LessComparable T>
+void introselect_helper(vector<T> &arr, size_t lo, size_t hi, size_t k,
+                        size_t budget) {
+    size_t small = tuning().select_small;
+    while (hi - lo > small) {
+        T pivot = budget == 0 ? median_of_medians(arr, lo, hi)
+                              : median_of_three(arr, lo, hi);
+        size_t range = hi - lo;
+        auto [lt, gt] = partition3(arr, lo, hi, pivot);
+        if (k < lt) {
+            hi = lt;
+        } else if (k >= gt) {
+            lo = gt;
+        } else {
+            return;
+        }
+        if (4 * (hi - lo) > 3 * range) {
+            budget -= budget > 0;
+        }
+    }
+    sort_small_range(arr, lo, hi);
+}
+
+/**
+ * Floyd–Rivest selection on the closed range `arr[left:right]`.
+ *
+ * For large ranges a small sample around the expected position of rank k is
+ * selected recursively first, so the element finally used as pivot is very
+ * close to the k-th and the partition discards almost everything at once.
+ */
+template <LessComparable T>
+void floyd_rivest_helper(vector<T> &arr, std::ptrdiff_t left,
+                         std::ptrdiff_t right, std::ptrdiff_t k) {
+    while (right > left) {
+        if (right - left > 600) {
+            double n = static_cast<double>(right - left + 1);
+            double i = static_cast<double>(k - left + 1);
+            double z = std::log(n);
+            double s = 0.5 * std::exp(2 * z / 3);
+            double sd = 0.5 * std::sqrt(z * s * (n - s) / n) *
+                        (i - n / 2 < 0 ? -1 : 1);
+            auto new_left = std::max(
+                left, static_cast<std::ptrdiff_t>(k - i * s / n + sd));
+            auto new_right = std::min(
+                right, static_cast<std::ptrdiff_t>(k + (n - i) * s / n + sd));
+            floyd_rivest_helper(arr, new_left, new_right, k);
+        }
+        T t = arr[k];
+        std::ptrdiff_t i = left;
+        std::ptrdiff_t j = right;
+        std::swap(arr[left], arr[k]);
+        if (t < arr[right]) {
+            std::swap(arr[right], arr[left]);
+        }
+        while (i < j) {
+            std::swap(arr[i], arr[j]);
+            i++;
+            j--;
+            while (arr[i] < t) {
+                i++;
+            }
+            while (t < arr[j]) {
+                j--;
+            }
+        }
+        if (!(arr[left] < t) && !(t < arr[left])) {
+            std::swap(arr[left], arr[j]);
+        } else {
+            j++;
+            std::swap(arr[j], arr[right]);
+        }
+        if (j <= k) {
+            left = j + 1;
+        }
+        if (k <= j) {
+            right = j - 1;
+        }
+    }
+}
+
+/**
+ * Selects every rank in `ranks[rlo:rhi)` (sorted, all inside `arr[lo:hi)`).
+ *
+ * The middle rank is selected first; that partitions the range, so the lower
+ * and upper ranks are independent subproblems on disjoint halves and large
+ * ones are forked onto the default pool.
+ */
+template <LessComparable T>
+void multi_select_helper(vector<T> &arr, size_t lo, size_t hi,
+                         const vector<size_t> &ranks, size_t rlo,
+                         size_t rhi) {
+    if (rlo >= rhi) {
+        return;
+    }
+    size_t rmid = rlo + (rhi - rlo) / 2;
+    size_t k = ranks[rmid];
+    introselect_helper(arr, lo, hi, k, INTROSELECT_BAD_ROUNDS);
+    if (hi - lo >= tuning().multi_select_parallel_cutoff && rhi - rlo > 1) {
+        TaskGroup group;
+        group.spawn([&arr, &ranks, lo, k, rlo, rmid] {
+            multi_select_helper(arr, lo, k, ranks, rlo, rmid);
+        });
+        multi_select_helper(arr, k + 1, hi, ranks, rmid + 1, rhi);
+        group.sync();
+    } else {
+        multi_select_helper(arr, lo, k, ranks, rlo, rmid);
+        multi_select_helper(arr, k + 1, hi, ranks, rmid + 1, rhi);
+    }
+}
+
+} // namespace detail
+
+/**
+ * Introselect: places the k-th smallest element (0-based) at `arr[k]`, with
+ * every element before it not larger and every element after it not
+ * smaller, in O(n) worst-case time. Returns that element, or `std::nullopt`
+ * when k is out of range.
+ */
+template <LessComparable T>
+auto introselect(vector<T> &arr, size_t k) -> std::optional<T> {
+    if (k >= arr.size()) {
+        return std::nullopt;
+    }
+    detail::introselect_helper(arr, 0, arr.size(), k,
+                               detail::INTROSELECT_BAD_ROUNDS);
+    return arr[k];
+}
+
+/**
+ * Floyd–Rivest selection, with the same contract as `introselect`. It makes
+ * close to n + min(k, n - k) comparisons on average, fewer than quickselect,
+ * but has no worst-case guarantee.
+ */
+template <LessComparable T>
+auto floyd_rivest_select(vector<T> &arr, size_t k) -> std::optional<T> {
+    if (k >= arr.size()) {
+        return std::nullopt;
+    }
+    detail::floyd_rivest_helper(arr, 0,
+                                static_cast<std::ptrdiff_t>(arr.size()) - 1,
+                                static_cast<std::ptrdiff_t>(k));
+    return arr[k];
+}
+
+/**
+ * Partial sort: afterwards `arr[0:k)` holds the k smallest elements in
+ * ascending order; the order of the rest is unspecified.
+ */
+template <LessComparable T> void partial_sort(vector<T> &arr, size_t k) {
+    if (k >= arr.size()) {
+        powersort(arr);
+        return;
+    }
+    if (k == 0) {
+        return;
+    }
+    detail::introselect_helper(arr, 0, arr.size(), k - 1,
+                               detail::INTROSELECT_BAD_ROUNDS);
+    if (k <= tuning().select_small) {
+        detail::sort_small_range(arr, 0, k);
+    } else {
+        vector<T> prefix(std::make_move_iterator(arr.begin()),
+                         std::make_move_iterator(arr.begin() + k));
+        powersort(prefix);
+        std::move(prefix.begin(), prefix.end(), arr.begin());
+    }
+}
+
+/**
+ * The k smallest elements of `arr` in ascending order, without modifying
+ * `arr`.
+ *
+ * A bounded max-heap of the best k seen so far is kept; its top is the
+ * admission threshold. For arithmetic types, once the heap is full the input
+ * is scanned in blocks of 16 with a branch-free `x < threshold` test, and
+ * only blocks containing a candidate are looked at element by element. For
+ * k much smaller than n almost every block is rejected by that vectorized
+ * filter.
+ */
+template <LessComparable T>
+auto top_k(const vector<T> &arr, size_t k) -> vector<T> {
+    k = std::min(k, arr.size());
+    if (k == 0) {
+        return {};
+    }
+    vector<T> heap(arr.begin(), arr.begin() + k);
+    std::make_heap(heap.begin(), heap.end());
+
+    auto offer = [&heap](const T &x) {
+        if (x < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = x;
+            std::push_heap(heap.begin(), heap.end());
+        }
+    };
+
+    size_t i = k;
+    if constexpr (std::is_arithmetic_v<T>) {
+        constexpr size_t block = 16;
+        for (; i + block <= arr.size(); i += block) {
+            const T *p = arr.data() + i;
+            T threshold = heap.front();
+            bool any = false;
+            for (size_t l = 0; l < block; l++) {
+                any |= p[l] < threshold;
+            }
+            if (any) {
+                for (size_t l = 0; l < block; l++) {
+                    offer(p[l]);
+                }
+            }
+        }
+    }
+    for (; i < arr.size(); i++) {
+        offer(arr[i]);
+    }
+    std::sort_heap(heap.begin(), heap.end());
+    return heap;
+}
+
+/**
+ * Selects several order statistics at once. Returns the elements of the
+ * given 0-based ranks, in the order the ranks were given; `arr` is left
+ * partitioned around every one of them. Out-of-range ranks yield
+ * `std::nullopt`.
+ *
+ * Each selection narrows the range for the ranks on either side of it, so
+ * q ranks cost O(n log q) rather than q full selections, and the
+ * independent halves of large ranges are processed in parallel.
+ */
+template <LessComparable T>
+auto multi_select(vector<T> &arr, const vector<size_t> &ranks)
+    -> vector<std::optional<T>> {
+    vector<size_t> sorted;
+    for (size_t r : ranks) {
+        if (r < arr.size()) {
+            sorted.push_back(r);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    detail::multi_select_helper(arr, 0, arr.size(), sorted, 0, sorted.size());
+
+    vector<std::optional<T>> result;
+    result.reserve(ranks.size());
+    for (size_t r : ranks) {
+        result.push_back(r < arr.size() ? std::optional<T>(arr[r])
+                                        : std::nullopt);
+    }
+    return result;
+}
+
+/**
+ * The q-quantiles of `arr` for each q in [0, 1] (nearest-rank definition),
+ * computed with a single `multi_select`.
+ */
+template <LessComparable T>
+auto quantiles(vector<T> &arr, const vector<double> &qs) -> vector<T> {
+    if (arr.empty()) {
+        return {};
+    }
+    vector<size_t> ranks;
+    ranks.reserve(qs.size());
+    for (double q : qs) {
+        double clamped = std::clamp(q, 0.0, 1.0);
+        ranks.push_back(static_cast<size_t>(
+            std::llround(clamped * static_cast<double>(arr.size() - 1))));
+    }
+    auto selected = multi_select(arr, ranks);
+    vector<T> result;
+    result.reserve(selected.size());
+    for (auto &value : selected) {
+        result.push_back(*value);
+    }
+    return result;
+}
+
+#endif // SELECTION_HPP
@@ -0,0 +1,290 @@
+// Sorting networks and batched sorting of many small arrays.
+
+#ifndef SORTING_NETWORK_HPP
+#define SORTING_NETWORK_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "chapter2.hpp"
+#include "error.hpp"
+
+/// Largest array length with a precomputed sorting network.
+inline constexpr size_t NETWORK_SORT_MAX = 64;
+
+/// Largest array length handled by `bitonic_sort`.
+inline constexpr size_t BITONIC_SORT_MAX = 256;
+
+namespace detail {
+
+/// A compare-exchange between two positions, `lo < hi`.
+struct Comparator {
+    uint8_t lo;
+    uint8_t hi;
+};
+
+/**
+ * Walks Batcher's odd-even merge sort network for the next power of two
+ * >= n and calls `emit(i, j)` for every comparator with both ends below n.
+ *
+ * Comparators that touch the padding are dropped: padding behaves like +inf
+ * and never moves, so the truncated network still sorts n elements.
+ */
+template <typename F> constexpr void batcher_walk(size_t n, F &&emit) {
+    size_t padded = std::bit_ceil(std::max<size_t>(n, 1));
+    for (size_t p = 1; p < padded; p += p) {
+        for (size_t k = p; k > 0; k /= 2) {
+            for (size_t j = k % p; j + k < padded; j += k + k) {
+                for (size_t i = 0; i < k && i + j + k < padded; i++) {
+                    size_t a = i + j;
+                    size_t b = i + j + k;
+                    if (a / (p + p) == b / (p + p) && b < n) {
+                        emit(a, b);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <size_t N> constexpr auto batcher_size() -> size_t {
+    size_t count = 0;
+    batcher_walk(N, [&](size_t, size_t) { count++; });
+    return count;
+}
+
+/// The comparators of the N-element network, generated at compile time.
+template <size_t N> constexpr auto batcher_network() {
+    std::array<Comparator, batcher_size<N>()> network{};
+    size_t count = 0;
+    batcher_walk(N, [&](size_t a, size_t b) {
+        network[count++] = {static_cast<uint8_t>(a), static_cast<uint8_t>(b)};
+    });
+    return network;
+}
+
+template <size_t N>
+inline constexpr auto BATCHER_NETWORK = batcher_network<N>();
+
+/// Compare-exchange written as two selects so it compiles to min/max or
+/// conditional moves instead of a branch.
+template <LessComparable T> inline void compare_exchange(T &a, T &b) {
+    bool swap = b < a;
+    T lo = swap ? b : a;
+    T hi = swap ? a : b;
+    a = std::move(lo);
+    b = std::move(hi);
+}
+
+/// Number of arrays sorted side by side in the interleaved batch kernel:
+/// one cache line worth of elements per network position.
+template <typename T>
+inline constexpr size_t BATCH_LANES = std::max<size_t>(1, 64 / sizeof(T));
+
+/**
+ * Applies the N-element network to `BATCH_LANES<T>` arrays stored
+ * interleaved, i.e. element i of every array is contiguous in
+ * `block[i * lanes : (i + 1) * lanes)`. Each comparator then becomes a
+ * lane-wise compare-exchange over two contiguous rows, which the compiler
+ * turns into packed SIMD min/max instructions. Unlike std::min/std::max,
+ * which both return the first argument on a tie, the selects keep both keys,
+ * so -0.0 and 0.0 are not collapsed into one.
+ */
+template <size_t N, typename T>
+    requires std::is_arithmetic_v<T>
+void sort_network_interleaved(T *block) {
+    constexpr size_t lanes = BATCH_LANES<T>;
+    for (const auto &c : BATCHER_NETWORK<N>) {
+        T *a = block + c.lo * lanes;
+        T *b = block + c.hi * lanes;
+        for (size_t l = 0; l < lanes; l++) {
+            compare_exchange(a[l], b[l]);
+        }
+    }
+}
+
+/// Largest value of T, used to pad inputs to a power of two.
+template <typename T> constexpr auto padding_value() -> T {
+    if constexpr (std::numeric_limits<T>::has_infinity) {
+        return std::numeric_limits<T>::infinity();
+    } else {
+        return std::numeric_limits<T>::max();
+    }
+}
+
+} // namespace detail
+
+/**
+ * Sorts the N elements starting at `arr` with a sorting network generated at
+ * compile time (Batcher's odd-even merge sort, truncated to N inputs).
+ *
+ * The sequence of compare-exchanges does not depend on the data, so there
+ * are no mispredicted branches. The sort is not stable.
+ */
+template <size_t N, LessComparable T>
+    requires(N <= NETWORK_SORT_MAX)
+void sort_network(T *arr) {
+    for (const auto &c : detail::BATCHER_NETWORK<N>) {
+        detail::compare_exchange(arr[c.lo], arr[c.hi]);
+    }
+}
+
+/**
+ * Sorts `data.size() / N` arrays of N elements laid out back to back.
+ *
+ * For arithmetic types the arrays are processed in groups of
+ * `detail::BATCH_LANES<T>`: each group is transposed into an interleaved
+ * scratch block, sorted with one SIMD compare-exchange per comparator for
+ * the whole group, and transposed back. Leftover arrays use `sort_network`
+ * directly.
+ */
+template <size_t N, LessComparable T>
+    requires(N <= NETWORK_SORT_MAX)
+void sort_network_batch(std::span<T> data) {
+    if constexpr (N < 2) {
+        return;
+    } else {
+        size_t count = data.size() / N;
+        size_t k = 0;
+        if constexpr (std::is_arithmetic_v<T>) {
+            constexpr size_t lanes = detail::BATCH_LANES<T>;
+            alignas(64) T block[N * lanes];
+            for (; k + lanes <= count; k += lanes) {
+                T *group = data.data() + k * N;
+                for (size_t l = 0; l < lanes; l++) {
+                    for (size_t i = 0; i < N; i++) {
+                        block[i * lanes + l] = group[l * N + i];
+                    }
+                }
+                detail::sort_network_interleaved<N>(block);
+                for (size_t l = 0; l < lanes; l++) {
+                    for (size_t i = 0; i < N; i++) {
+                        group[l * N + i] = block[i * lanes + l];
+                    }
+                }
+            }
+        }
+        for (; k < count; k++) {
+            sort_network<N>(data.data() + k * N);
+        }
+    }
+}
+
+/**
+ * Bitonic sort of `arr[0:n)`.
+ *
+ * The input is copied into a stack buffer padded to a power of two, which
+ * stays in L1 for every supported size. Within one merge step all
+ * compare-exchanges of a block go in the same direction, so the inner loop is
+ * a plain lane-wise compare-exchange that vectorizes. NaNs are not supported.
+ * Lengths above BITONIC_SORT_MAX do not fit the buffer and fall back to
+ * std::sort.
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+void bitonic_sort(T *arr, size_t n) {
+    if (n < 2) {
+        return;
+    }
+    if (n > BITONIC_SORT_MAX) {
+        std::sort(arr, arr + n);
+        return;
+    }
+    alignas(64) T buf[BITONIC_SORT_MAX];
+    size_t padded = std::bit_ceil(n);
+    std::copy_n(arr, n, buf);
+    std::fill(buf + n, buf + padded, detail::padding_value<T>());
+    for (size_t k = 2; k <= padded; k <<= 1) {
+        for (size_t j = k >> 1; j > 0; j >>= 1) {
+            for (size_t base = 0; base < padded; base += j + j) {
+                T *a = buf + base;
+                T *b = buf + base + j;
+                if ((base & k) == 0) {
+                    for (size_t t = 0; t < j; t++) {
+                        detail::compare_exchange(a[t], b[t]);
+                    }
+                } else {
+                    for (size_t t = 0; t < j; t++) {
+                        detail::compare_exchange(b[t], a[t]);
+                    }
+                }
+            }
+        }
+    }
+    std::copy_n(buf, n, arr);
+}
+
+namespace detail {
+
+template <typename T>
+using SortBatchFn = void (*)(std::span<T>);
+
+template <LessComparable T, size_t... I>
+constexpr auto make_sort_batch_table(std::index_sequence<I...>) {
+    return std::array<SortBatchFn<T>, sizeof...(I)>{
+        &sort_network_batch<I, T>...};
+}
+
+template <LessComparable T>
+inline constexpr auto SORT_BATCH_TABLE = make_sort_batch_table<T>(
+    std::make_index_sequence<NETWORK_SORT_MAX + 1>{});
+
+} // namespace detail
+
+/**
+ * Sorts the n elements starting at `arr`.
+ *
+ * Meant as the base case of the larger sorts: lengths up to
+ * NETWORK_SORT_MAX use a sorting network, longer ones `bitonic_sort`, which
+ * falls back to std::sort above BITONIC_SORT_MAX.
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+void small_sort(T *arr, size_t n) {
+    if (n <= NETWORK_SORT_MAX) {
+        detail::SORT_BATCH_TABLE<T>[n](std::span<T>(arr, n));
+    } else {
+        bitonic_sort(arr, n);
+    }
+}
+
+/**
+ * Sorts every length-n array in `data`, which holds `data.size() / n` of
+ * them back to back, in a single call.
+ *
+ * Lengths up to NETWORK_SORT_MAX dispatch once to the batched network of that
+ * size; lengths up to BITONIC_SORT_MAX use `bitonic_sort` per array.
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto sort_batch(std::span<T> data, size_t n) -> std::expected<void, Error> {
+    if (n == 0 || data.size() % n != 0) {
+        return std::unexpected<Error>(Error::InvalidArgument(
+            std::format("batch of {} elements is not a whole number of "
+                        "arrays of length {}",
+                        data.size(), n)));
+    }
+    if (n > BITONIC_SORT_MAX) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "array length {} exceeds the batched sort limit of {}", n,
+            BITONIC_SORT_MAX)));
+    }
+    if (n <= NETWORK_SORT_MAX) {
+        detail::SORT_BATCH_TABLE<T>[n](data);
+    } else {
+        for (size_t k = 0; k < data.size(); k += n) {
+            bitonic_sort(data.data() + k, n);
+        }
+    }
+    return {};
+}
+
+#endif // SORTING_NETWORK_HPP
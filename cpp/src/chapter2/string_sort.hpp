@@ -0,0 +1,339 @@
+// String sorting: multikey quicksort, MSD radix sort and LCP merge sort.
+
+#ifndef STRING_SORT_HPP
+#define STRING_SORT_HPP
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tuning.hpp"
+
+using std::vector;
+
+/// Size of the character blocks of a StringArena.
+inline constexpr size_t STRING_ARENA_BLOCK = 1 << 16;
+
+template <typename S>
+concept StringLike = std::convertible_to<const S &, std::string_view> &&
+                     std::movable<S> && std::default_initializable<S>;
+
+namespace detail {
+
+/// The character at `depth` shifted up by one, or 0 past the end, so that a
+/// string sorts before its extensions and embedded '\0' stays distinct.
+inline auto char_at(std::string_view s, size_t depth) -> uint16_t {
+    return depth < s.size()
+               ? static_cast<uint16_t>(static_cast<unsigned char>(s[depth]) + 1)
+               : 0;
+}
+
+/// Insertion sort of [0, n) when every string shares its first `depth`
+/// characters, which are skipped in every comparison.
+template <StringLike S>
+void string_insertion_sort(S *a, size_t n, size_t depth) {
+    for (size_t i = 1; i < n; i++) {
+        S key = std::move(a[i]);
+        std::string_view k = std::string_view(key).substr(
+            std::min(depth, std::string_view(key).size()));
+        size_t j = i;
+        while (j > 0) {
+            std::string_view prev = a[j - 1];
+            if (prev.substr(std::min(depth, prev.size())) <= k) {
+                break;
+            }
+            a[j] = std::move(a[j - 1]);
+            j--;
+        }
+        a[j] = std::move(key);
+    }
+}
+
+/**
+ * Bentley and Sedgewick's multikey quicksort of [0, n), all strings sharing
+ * their first `depth` characters. Partitions three ways on the character at
+ * `depth`; only the middle part advances to the next character, so every
+ * character is examined O(log n) times on average instead of once per
+ * comparison.
+ */
+template <StringLike S>
+void multikey_quicksort_helper(S *a, size_t n, size_t depth) {
+    size_t cutoff = tuning().string_insertion_cutoff;
+    while (n > cutoff) {
+        uint16_t x = char_at(a[0], depth);
+        uint16_t y = char_at(a[n / 2], depth);
+        uint16_t z = char_at(a[n - 1], depth);
+        uint16_t pivot = std::max(std::min(x, y), std::min(std::max(x, y), z));
+
+        // a[0, lt) < pivot, a[lt, i) == pivot, a[gt, n) > pivot
+        size_t lt = 0;
+        size_t i = 0;
+        size_t gt = n;
+        while (i < gt) {
+            uint16_t c = char_at(a[i], depth);
+            if (c < pivot) {
+                std::swap(a[lt++], a[i++]);
+            } else if (c > pivot) {
+                std::swap(a[i], a[--gt]);
+            } else {
+                i++;
+            }
+        }
+        multikey_quicksort_helper(a, lt, depth);
+        multikey_quicksort_helper(a + gt, n - gt, depth);
+        if (pivot == 0) {
+            return; // the middle part holds equal, fully consumed strings
+        }
+        a += lt;
+        n = gt - lt;
+        depth++;
+    }
+    string_insertion_sort(a, n, depth);
+}
+
+/**
+ * MSD radix sort of [0, n) at `depth`. The characters at `depth` are read
+ * from the strings once into `cache`, a dense array that the counting and
+ * distribution passes then scan instead of chasing every string pointer
+ * twice. A level at which all strings share the character is skipped
+ * without distributing.
+ */
+template <StringLike S>
+void msd_radix_helper(S *a, size_t n, size_t depth, S *buf,
+                      uint16_t *cache) {
+    size_t cutoff = tuning().msd_radix_cutoff;
+    while (n >= cutoff) {
+        std::array<size_t, 258> start{};
+        for (size_t i = 0; i < n; i++) {
+            cache[i] = char_at(a[i], depth);
+            start[cache[i] + 1]++;
+        }
+        if (start[cache[0] + 1] == n) {
+            if (cache[0] == 0) {
+                return;
+            }
+            depth++;
+            continue;
+        }
+        for (size_t c = 1; c < start.size(); c++) {
+            start[c] += start[c - 1];
+        }
+        std::array<size_t, 258> next = start;
+        for (size_t i = 0; i < n; i++) {
+            buf[next[cache[i]]++] = std::move(a[i]);
+        }
+        std::move(buf, buf + n, a);
+        // Bucket 0 holds strings that ended; they are all equal.
+        for (size_t c = 1; c < 257; c++) {
+            size_t size = start[c + 1] - start[c];
+            if (size > 1) {
+                msd_radix_helper(a + start[c], size, depth + 1, buf, cache);
+            }
+        }
+        return;
+    }
+    multikey_quicksort_helper(a, n, depth);
+}
+
+/// Length of the common prefix of a and b, starting the scan at `from`.
+inline auto lcp_from(std::string_view a, std::string_view b, size_t from)
+    -> size_t {
+    size_t limit = std::min(a.size(), b.size());
+    while (from < limit && a[from] == b[from]) {
+        from++;
+    }
+    return from;
+}
+
+/**
+ * Merges the sorted runs a and b, whose LCP arrays give the common prefix of
+ * every element with its predecessor, into `out` and `out_lcp`.
+ *
+ * `ha` and `hb` track the common prefix of the last element written with
+ * the heads of a and b. If they differ the head with the longer one is the
+ * smaller and no characters are read; only on a tie are the heads compared,
+ * starting after the prefix already known to be shared. Equal strings are
+ * taken from a first, so the merge is stable.
+ */
+template <StringLike S>
+void lcp_merge(S *a, const size_t *lcp_a, size_t na, S *b,
+               const size_t *lcp_b, size_t nb, S *out, size_t *out_lcp) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t k = 0;
+    size_t ha = 0;
+    size_t hb = 0;
+    auto take_a = [&] {
+        out_lcp[k] = ha;
+        out[k++] = std::move(a[i++]);
+        ha = i < na ? lcp_a[i] : 0;
+    };
+    auto take_b = [&] {
+        out_lcp[k] = hb;
+        out[k++] = std::move(b[j++]);
+        hb = j < nb ? lcp_b[j] : 0;
+    };
+    while (i < na && j < nb) {
+        if (ha > hb) {
+            take_a();
+        } else if (hb > ha) {
+            take_b();
+        } else {
+            std::string_view x = a[i];
+            std::string_view y = b[j];
+            size_t h = lcp_from(x, y, ha);
+            // x <= y: x is a prefix of y, or the first difference is smaller
+            bool a_first = h == x.size() ||
+                           (h < y.size() && char_at(x, h) < char_at(y, h));
+            if (a_first) {
+                take_a();
+                hb = h;
+            } else {
+                take_b();
+                ha = h;
+            }
+        }
+    }
+    for (bool first = true; i < na; first = false) {
+        out_lcp[k] = first ? ha : lcp_a[i];
+        out[k++] = std::move(a[i++]);
+    }
+    for (bool first = true; j < nb; first = false) {
+        out_lcp[k] = first ? hb : lcp_b[j];
+        out[k++] = std::move(b[j++]);
+    }
+}
+
+/**
+ * Sorts [0, n) of `a` and fills `lcp` (lcp[0] = 0), using `buf` and
+ * `buf_lcp` as merge targets.
+ */
+template <StringLike S>
+void lcp_merge_sort_helper(S *a, size_t *lcp, size_t n, S *buf,
+                           size_t *buf_lcp) {
+    if (n <= tuning().string_insertion_cutoff) {
+        string_insertion_sort(a, n, 0);
+        if (n > 0) {
+            lcp[0] = 0;
+        }
+        for (size_t i = 1; i < n; i++) {
+            lcp[i] = lcp_from(a[i - 1], a[i], 0);
+        }
+        return;
+    }
+    size_t mid = n / 2;
+    lcp_merge_sort_helper(a, lcp, mid, buf, buf_lcp);
+    lcp_merge_sort_helper(a + mid, lcp + mid, n - mid, buf, buf_lcp);
+    lcp_merge(a, lcp, mid, a + mid, lcp + mid, n - mid, buf, buf_lcp);
+    std::move(buf, buf + n, a);
+    std::copy_n(buf_lcp, n, lcp);
+}
+
+} // namespace detail
+
+/**
+ * Multikey quicksort (three-way radix quicksort) of strings or string views.
+ *
+ * Not stable. Expected O(n log n + D) character reads, D being the total
+ * length of the distinguishing prefixes.
+ */
+template <StringLike S> void multikey_quicksort(vector<S> &arr) {
+    detail::multikey_quicksort_helper(arr.data(), arr.size(), 0);
+}
+
+/**
+ * MSD radix sort of strings or string views, with the current character of
+ * every string cached in a dense array while a range is distributed.
+ *
+ * Not stable. Ranges shorter than `tuning().msd_radix_cutoff` finish with
+ * multikey quicksort.
+ */
+template <StringLike S> void msd_radix_sort(vector<S> &arr) {
+    size_t n = arr.size();
+    if (n < 2) {
+        return;
+    }
+    vector<S> buf(n);
+    auto cache = std::make_unique<uint16_t[]>(n);
+    detail::msd_radix_helper(arr.data(), n, 0, buf.data(), cache.get());
+}
+
+/**
+ * Stable merge sort of strings or string views that carries the longest
+ * common prefix of every element with its predecessor through the merges,
+ * so that shared prefixes are never compared twice.
+ *
+ * @return The LCP array of the sorted output: `lcp[i]` is the length of the
+ * common prefix of `arr[i - 1]` and `arr[i]`, with `lcp[0] = 0`
+ */
+template <StringLike S> auto lcp_merge_sort(vector<S> &arr) -> vector<size_t> {
+    size_t n = arr.size();
+    vector<size_t> lcp(n);
+    vector<S> buf(n);
+    vector<size_t> buf_lcp(n);
+    detail::lcp_merge_sort_helper(arr.data(), lcp.data(), n, buf.data(),
+                                  buf_lcp.data());
+    return lcp;
+}
+
+/**
+ * Views of `strings` in sorted order. Only the views are moved; the
+ * characters stay where they are.
+ */
+inline auto sorted_views(const vector<std::string> &strings)
+    -> vector<std::string_view> {
+    vector<std::string_view> views(strings.begin(), strings.end());
+    msd_radix_sort(views);
+    return views;
+}
+
+/**
+ * @brief Append-only storage for many short strings, handed out as views
+ *
+ * Characters are copied once into large blocks; blocks are never moved, so
+ * the views stay valid for the lifetime of the arena. Sorting reorders the
+ * views only.
+ */
+class StringArena {
+  private:
+    vector<std::unique_ptr<char[]>> m_blocks;
+    size_t m_used = 0;
+    size_t m_capacity = 0;
+    vector<std::string_view> m_views;
+
+  public:
+    StringArena() = default;
+
+    /// Copies `s` into the arena and returns the view of the copy.
+    std::string_view push(std::string_view s) {
+        if (m_blocks.empty() || s.size() > m_capacity - m_used) {
+            size_t size = std::max(STRING_ARENA_BLOCK, s.size());
+            m_blocks.push_back(std::make_unique<char[]>(size));
+            m_used = 0;
+            m_capacity = size;
+        }
+        char *dest = m_blocks.back().get() + m_used;
+        std::copy(s.begin(), s.end(), dest);
+        m_used += s.size();
+        m_views.emplace_back(dest, s.size());
+        return m_views.back();
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return m_views.size(); }
+
+    /// The stored strings, in insertion order until `sort` is called.
+    [[nodiscard]] const vector<std::string_view> &views() const noexcept {
+        return m_views;
+    }
+
+    /// Sorts the views with `msd_radix_sort`.
+    void sort() { msd_radix_sort(m_views); }
+};
+
+#endif // STRING_SORT_HPP
@@ -1 +1,393 @@
 // Chapter 4 Divide and Conquer
+
+#ifndef CHAPTER4_HPP
+#define CHAPTER4_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "error.hpp"
+#include "parallel.hpp"
+#include "tuning.hpp"
+
+using std::vector;
+
+/**
+ * @brief The two closest points of a set, by their input positions
+ */
+struct ClosestPair {
+    size_t first = 0; ///< Smaller index of the pair
+    size_t second = 0; ///< Larger index of the pair
+    double distance = 0.0;
+};
+
+namespace detail {
+
+/// Best pair found so far, compared by squared distance.
+struct PairCandidate {
+    double dist2 = std::numeric_limits<double>::infinity();
+    size_t first = 0;
+    size_t second = 0;
+
+    void consider(double dx, double dy, size_t a, size_t b) {
+        double d2 = dx * dx + dy * dy;
+        if (d2 < dist2) {
+            dist2 = d2;
+            first = a;
+            second = b;
+        }
+    }
+};
+
+/**
+ * Points as separate coordinate arrays (structure of arrays), so that the
+ * strip scans and merges stream through contiguous doubles. `px, py, pid`
+ * hold the points sorted by x once up front. `yx, yy, yid` receive every
+ * subrange sorted by y as the recursion returns, and `sx, sy, sid` are the
+ * merge target and strip buffer. Ranges handed to different tasks are
+ * disjoint in every array.
+ */
+struct ClosestPairArrays {
+    const double *px;
+    const double *py;
+    const size_t *pid;
+    double *yx;
+    double *yy;
+    size_t *yid;
+    double *sx;
+    double *sy;
+    size_t *sid;
+};
+
+inline auto closest_pair_helper(const ClosestPairArrays &a, size_t lo,
+                                size_t hi, bool parallel) -> PairCandidate {
+    PairCandidate best;
+    if (hi - lo <= tuning().closest_pair_brute_force) {
+        for (size_t i = lo; i < hi; i++) {
+            for (size_t j = i + 1; j < hi; j++) {
+                best.consider(a.px[i] - a.px[j], a.py[i] - a.py[j], a.pid[i],
+                              a.pid[j]);
+            }
+        }
+        // Insertion sort of the range by y into the y-ordered arrays.
+        for (size_t i = lo; i < hi; i++) {
+            double x = a.px[i];
+            double y = a.py[i];
+            size_t id = a.pid[i];
+            size_t j = i;
+            while (j > lo && a.yy[j - 1] > y) {
+                a.yx[j] = a.yx[j - 1];
+                a.yy[j] = a.yy[j - 1];
+                a.yid[j] = a.yid[j - 1];
+                j--;
+            }
+            a.yx[j] = x;
+            a.yy[j] = y;
+            a.yid[j] = id;
+        }
+        return best;
+    }
+
+    size_t mid = lo + (hi - lo) / 2;
+    double split = a.px[mid];
+    PairCandidate left;
+    PairCandidate right;
+    if (parallel && hi - lo >= tuning().closest_pair_parallel_cutoff) {
+        TaskGroup group;
+        group.spawn([&a, &left, lo, mid] {
+            left = closest_pair_helper(a, lo, mid, true);
+        });
+        right = closest_pair_helper(a, mid, hi, true);
+        group.sync();
+    } else {
+        left = closest_pair_helper(a, lo, mid, parallel);
+        right = closest_pair_helper(a, mid, hi, parallel);
+    }
+    best = left.dist2 <= right.dist2 ? left : right;
+
+    // Merge the two y-sorted halves: linear, no re-sorting per level.
+    size_t i = lo;
+    size_t j = mid;
+    for (size_t k = lo; k < hi; k++) {
+        bool take_left = j == hi || (i < mid && a.yy[i] <= a.yy[j]);
+        size_t from = take_left ? i++ : j++;
+        a.sx[k] = a.yx[from];
+        a.sy[k] = a.yy[from];
+        a.sid[k] = a.yid[from];
+    }
+    std::copy(a.sx + lo, a.sx + hi, a.yx + lo);
+    std::copy(a.sy + lo, a.sy + hi, a.yy + lo);
+    std::copy(a.sid + lo, a.sid + hi, a.yid + lo);
+
+    // Points within the current best distance of the split line, in y order.
+    size_t strip = lo;
+    for (size_t k = lo; k < hi; k++) {
+        double dx = a.yx[k] - split;
+        if (dx * dx < best.dist2) {
+            a.sx[strip] = a.yx[k];
+            a.sy[strip] = a.yy[k];
+            a.sid[strip] = a.yid[k];
+            strip++;
+        }
+    }
+    // Only points less than the best distance apart in y can improve it;
+    // packing arguments bound these to a constant number per point.
+    for (size_t k = lo; k < strip; k++) {
+        for (size_t l = k + 1; l < strip; l++) {
+            double dy = a.sy[l] - a.sy[k];
+            if (dy * dy >= best.dist2) {
+                break;
+            }
+            best.consider(a.sx[l] - a.sx[k], dy, a.sid[k], a.sid[l]);
+        }
+    }
+    return best;
+}
+
+inline auto validate_points(const vector<double> &xs, const vector<double> &ys)
+    -> std::expected<void, Error> {
+    if (xs.size() != ys.size()) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "{} x coordinates but {} y coordinates", xs.size(), ys.size())));
+    }
+    if (xs.size() < 2) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "closest pair needs at least 2 points, got {}", xs.size())));
+    }
+    for (size_t i = 0; i < xs.size(); i++) {
+        if (!std::isfinite(xs[i]) || !std::isfinite(ys[i])) {
+            return std::unexpected<Error>(Error::InvalidArgument(
+                std::format("point {} has a non-finite coordinate", i)));
+        }
+    }
+    return {};
+}
+
+inline auto to_closest_pair(const PairCandidate &best) -> ClosestPair {
+    return {std::min(best.first, best.second),
+            std::max(best.first, best.second), std::sqrt(best.dist2)};
+}
+
+inline auto closest_pair_impl(const vector<double> &xs,
+                              const vector<double> &ys, bool parallel)
+    -> std::expected<ClosestPair, Error> {
+    auto valid = validate_points(xs, ys);
+    if (!valid) {
+        return std::unexpected<Error>(valid.error());
+    }
+    size_t n = xs.size();
+    vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return xs[a] < xs[b] || (xs[a] == xs[b] && ys[a] < ys[b]);
+    });
+    vector<double> px(n);
+    vector<double> py(n);
+    for (size_t i = 0; i < n; i++) {
+        px[i] = xs[order[i]];
+        py[i] = ys[order[i]];
+    }
+    vector<double> yx(n);
+    vector<double> yy(n);
+    vector<size_t> yid(n);
+    vector<double> sx(n);
+    vector<double> sy(n);
+    vector<size_t> sid(n);
+    ClosestPairArrays arrays{px.data(), py.data(), order.data(),
+                             yx.data(), yy.data(), yid.data(),
+                             sx.data(), sy.data(), sid.data()};
+    return to_closest_pair(closest_pair_helper(arrays, 0, n, parallel));
+}
+
+/**
+ * Hash grid of points for `closest_pair_grid`: an open-addressing table from
+ * cell key to the most recently inserted point of the cell, and a `next`
+ * array chaining the points of a cell. Nothing is allocated per cell, and
+ * clearing touches only the table.
+ */
+class CellGrid {
+  private:
+    static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+    vector<uint64_t> m_keys;
+    vector<size_t> m_heads;
+    vector<size_t> m_next;
+    size_t m_cells = 0;
+    int m_shift = 64;
+
+    [[nodiscard]] size_t slot(uint64_t key) const {
+        size_t mask = m_keys.size() - 1;
+        size_t s = (key * 0xbf58476d1ce4e5b9ULL) >> m_shift;
+        while (m_heads[s] != NONE && m_keys[s] != key) {
+            s = (s + 1) & mask;
+        }
+        return s;
+    }
+
+  public:
+    explicit CellGrid(size_t points) : m_next(points, NONE) {}
+
+    /// Empties the grid and sizes the table for `points` points.
+    void reset(size_t points) {
+        size_t capacity = std::bit_ceil(std::max<size_t>(16, 2 * points));
+        m_keys.assign(capacity, 0);
+        m_heads.assign(capacity, NONE);
+        m_cells = 0;
+        m_shift = 64 - std::countr_zero(capacity);
+    }
+
+    /// Cells may share a key; that only adds candidates to check.
+    static uint64_t key(int64_t cx, int64_t cy) {
+        return static_cast<uint64_t>(cx) * 0x9e3779b97f4a7c15ULL ^
+               static_cast<uint64_t>(cy);
+    }
+
+    [[nodiscard]] size_t cells() const noexcept { return m_cells; }
+    [[nodiscard]] size_t capacity() const noexcept { return m_keys.size(); }
+
+    void insert(uint64_t key, size_t point) {
+        size_t s = slot(key);
+        if (m_heads[s] == NONE) {
+            m_keys[s] = key;
+            m_cells++;
+        }
+        m_next[point] = m_heads[s];
+        m_heads[s] = point;
+    }
+
+    /// Calls `f(point)` for every point in the cell with this key.
+    template <typename F> void for_each(uint64_t key, F &&f) const {
+        for (size_t p = m_heads[slot(key)]; p != NONE; p = m_next[p]) {
+            f(p);
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * Closest pair of points (section 33.4), O(n log n).
+ *
+ * The points are sorted by x once. The recursion returns every subrange
+ * sorted by y, so each level merges the y orders of its halves in linear
+ * time and builds the strip around the split line from the merged order,
+ * instead of sorting again.
+ *
+ * @return The pair and its Euclidean distance, or an error if the
+ * coordinate arrays differ in length, hold fewer than two points or contain
+ * a non-finite value
+ */
+inline auto closest_pair(const vector<double> &xs, const vector<double> &ys)
+    -> std::expected<ClosestPair, Error> {
+    return detail::closest_pair_impl(xs, ys, false);
+}
+
+/**
+ * Same as `closest_pair`, but both halves of every subproblem of at least
+ * `tuning().closest_pair_parallel_cutoff` points are solved in parallel on
+ * the default pool.
+ */
+inline auto parallel_closest_pair(const vector<double> &xs,
+                                  const vector<double> &ys)
+    -> std::expected<ClosestPair, Error> {
+    return detail::closest_pair_impl(xs, ys, true);
+}
+
+/**
+ * Closest pair by randomized incremental grid hashing, expected O(n).
+ *
+ * Points are inserted in random order into a hash grid whose cells are as
+ * wide as the closest distance d seen so far, so a point closer than d to
+ * the new one lies in one of the 9 surrounding cells. Each time d shrinks
+ * the grid is rebuilt from the points inserted so far; in random order the
+ * i-th point shrinks d with probability at most 2 / i, which keeps the
+ * expected total work linear. Meant for comparison with `closest_pair`.
+ *
+ * @return As for `closest_pair`
+ */
+inline auto closest_pair_grid(const vector<double> &xs,
+                              const vector<double> &ys, uint64_t seed = 0)
+    -> std::expected<ClosestPair, Error> {
+    auto valid = detail::validate_points(xs, ys);
+    if (!valid) {
+        return std::unexpected<Error>(valid.error());
+    }
+    size_t n = xs.size();
+    vector<size_t> perm(n);
+    std::iota(perm.begin(), perm.end(), 0);
+    std::mt19937_64 gen(seed);
+    std::shuffle(perm.begin(), perm.end(), gen);
+
+    auto [min_x, max_x] = std::minmax_element(xs.begin(), xs.end());
+    auto [min_y, max_y] = std::minmax_element(ys.begin(), ys.end());
+    double span = std::max(*max_x - *min_x, *max_y - *min_y);
+    double origin_x = *min_x;
+    double origin_y = *min_y;
+
+    detail::PairCandidate best;
+    best.consider(xs[perm[0]] - xs[perm[1]], ys[perm[0]] - ys[perm[1]],
+                  perm[0], perm[1]);
+    double cell = 0.0;
+    detail::CellGrid grid(n);
+    auto cell_of = [&](size_t p) {
+        return std::pair<int64_t, int64_t>(
+            static_cast<int64_t>((xs[p] - origin_x) / cell),
+            static_cast<int64_t>((ys[p] - origin_y) / cell));
+    };
+    // Rebuilds the grid from points perm[0..count); false if cells this
+    // small would overflow the integer cell coordinates.
+    auto rebuild = [&](size_t count) {
+        cell = std::sqrt(best.dist2);
+        if (span / cell > 0x1p52) {
+            return false;
+        }
+        grid.reset(count);
+        for (size_t i = 0; i < count; i++) {
+            auto [cx, cy] = cell_of(perm[i]);
+            grid.insert(detail::CellGrid::key(cx, cy), perm[i]);
+        }
+        return true;
+    };
+
+    if (best.dist2 == 0.0) {
+        return detail::to_closest_pair(best);
+    }
+    if (!rebuild(2)) {
+        return closest_pair(xs, ys);
+    }
+    for (size_t i = 2; i < n; i++) {
+        size_t p = perm[i];
+        auto [cx, cy] = cell_of(p);
+        double before = best.dist2;
+        for (int64_t dx = -1; dx <= 1; dx++) {
+            for (int64_t dy = -1; dy <= 1; dy++) {
+                grid.for_each(detail::CellGrid::key(cx + dx, cy + dy),
+                              [&](size_t q) {
+                                  best.consider(xs[p] - xs[q], ys[p] - ys[q],
+                                                q, p);
+                              });
+            }
+        }
+        if (best.dist2 == 0.0) {
+            break;
+        }
+        if (best.dist2 < before || 2 * (grid.cells() + 1) > grid.capacity()) {
+            // A new closest distance, or a table due to grow.
+            if (!rebuild(i + 1)) {
+                return closest_pair(xs, ys);
+            }
+        } else {
+            grid.insert(detail::CellGrid::key(cx, cy), p);
+        }
+    }
+    return detail::to_closest_pair(best);
+}
+
+#endif // CHAPTER4_HPP
@@ -8,6 +8,7 @@ target("chapter4")
     set_kind("binary")
     add_files("main.cpp")
     add_deps("chapter4_lib")
+    add_syslinks("pthread")
     set_targetdir("$(builddir)")
     set_rundir("$(projectdir)")
 
@@ -28,6 +28,35 @@ struct Error {
     static auto InvalidArgument(const std::string &msg) -> Error {
         return Error("Invalid argument: " + msg);
     }
+
+    /**
+     * @brief Creates an error for an operation stopped by a cancellation
+     * request
+     * @param msg Additional context about the cancelled operation
+     * @return Error instance representing a cancellation
+     */
+    static auto Cancelled(const std::string &msg) -> Error {
+        return Error("Cancelled: " + msg);
+    }
+
+    /**
+     * @brief Creates an error for a matrix that is singular to working
+     * precision
+     * @param msg Additional context about where singularity was detected
+     * @return Error instance representing a singular matrix
+     */
+    static auto SingularMatrix(const std::string &msg) -> Error {
+        return Error("Singular matrix: " + msg);
+    }
+
+    /**
+     * @brief Creates an error for a file that could not be read or written
+     * @param msg Additional context about the failed operation
+     * @return Error instance representing an I/O failure
+     */
+    static auto IoError(const std::string &msg) -> Error {
+        return Error("I/O error: " + msg);
+    }
 };
 
 #endif // ERROR_HPP
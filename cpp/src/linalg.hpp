@@ -0,0 +1,463 @@
+#ifndef LINALG_HPP
+#define LINALG_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <expected>
+#include <format>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "error.hpp"
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "reduction.hpp"
+#include "tuning.hpp"
+
+using std::vector;
+
+/**
+ * @brief C = alpha * A * B + beta * C
+ *
+ * Row-major blocked kernel: for every row of C and every k-block, row k of B
+ * is scaled by A(i, k) and accumulated into row i of C, so the innermost loop
+ * streams contiguous rows and vectorizes. Products with more than
+ * `tuning().gemm_row_grain` rows are split over the default pool with
+ * `parallel_rows`, so each worker updates the rows of C it first touched.
+ * The k-block depth also comes from the active TuningProfile.
+ *
+ * @return An error if the shapes of A, B and C do not agree
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto gemm(T alpha, const MatrixView<T> &a, const MatrixView<T> &b, T beta,
+          MatrixViewMut<T> c) -> std::expected<void, Error> {
+    size_t m = a.nrows();
+    size_t k = a.ncols();
+    size_t n = b.ncols();
+    if (b.nrows() != k || c.nrows() != m || c.ncols() != n) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "cannot multiply {}x{} by {}x{} into {}x{}", m, k, b.nrows(), n,
+            c.nrows(), c.ncols())));
+    }
+    const T *pa = a.data();
+    const T *pb = b.data();
+    T *pc = c.data();
+    size_t lda = a.stride();
+    size_t ldb = b.stride();
+    size_t ldc = c.stride();
+    size_t block_k = tuning().gemm_block_k;
+    auto body = [=](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++) {
+            T *row = pc + i * ldc;
+            if (beta == T{}) {
+                std::fill_n(row, n, T{});
+            } else if (beta != T{1}) {
+                for (size_t j = 0; j < n; j++) {
+                    row[j] *= beta;
+                }
+            }
+        }
+        for (size_t k0 = 0; k0 < k; k0 += block_k) {
+            size_t k1 = std::min(k0 + block_k, k);
+            for (size_t i = lo; i < hi; i++) {
+                T *row = pc + i * ldc;
+                for (size_t p = k0; p < k1; p++) {
+                    T scale = alpha * pa[i * lda + p];
+                    const T *brow = pb + p * ldb;
+                    for (size_t j = 0; j < n; j++) {
+                        row[j] += scale * brow[j];
+                    }
+                }
+            }
+        }
+    };
+    if (m <= tuning().gemm_row_grain) {
+        body(0, m);
+    } else {
+        parallel_rows(m, [&](size_t, size_t lo, size_t hi) { body(lo, hi); });
+    }
+    return {};
+}
+
+/**
+ * @brief Matrix product A * B
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto matmul(const Matrix<T> &a, const Matrix<T> &b)
+    -> std::expected<Matrix<T>, Error> {
+    Matrix<T> c(a.nrows(), b.ncols());
+    auto status = gemm(T{1}, a.view(0, 0, a.nrows(), a.ncols()),
+                       b.view(0, 0, b.nrows(), b.ncols()), T{},
+                       c.view_mut(0, 0, c.nrows(), c.ncols()));
+    if (!status) {
+        return std::unexpected<Error>(status.error());
+    }
+    return c;
+}
+
+/**
+ * @brief y = alpha * A * x + beta * y
+ *
+ * Every entry of y is a dot product of a contiguous row of A with x, taken
+ * with `detail::dot`'s independent SIMD lanes. Matrices with at least
+ * `tuning().gemv_parallel_min` entries are split over the default pool
+ * with `parallel_rows`.
+ *
+ * @return An error if the lengths of x and y do not match A
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto gemv(T alpha, const MatrixView<T> &a, std::span<const T> x, T beta,
+          std::span<T> y) -> std::expected<void, Error> {
+    size_t m = a.nrows();
+    size_t n = a.ncols();
+    if (x.size() != n || y.size() != m) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "cannot multiply {}x{} by a vector of {} into one of {}", m, n,
+            x.size(), y.size())));
+    }
+    auto body = [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++) {
+            T value = alpha * detail::dot(a.data() + i * a.stride(),
+                                          x.data(), n);
+            y[i] = beta == T{} ? value : value + beta * y[i];
+        }
+    };
+    if (m * n >= tuning().gemv_parallel_min) {
+        parallel_rows(m, [&](size_t, size_t lo, size_t hi) { body(lo, hi); });
+    } else {
+        body(0, m);
+    }
+    return {};
+}
+
+namespace detail {
+
+/**
+ * acc += A[lo:hi)^T x[lo:hi). Rows are consumed REDUCE_COL_ROWS at a time,
+ * so each pass over `acc` folds in four scaled rows with contiguous loads
+ * and stores only.
+ */
+template <typename T>
+void gemv_transposed_range(const MatrixView<T> &a, std::span<const T> x,
+                           size_t lo, size_t hi, T *acc) {
+    size_t n = a.ncols();
+    size_t stride = a.stride();
+    size_t i = lo;
+    for (; i + REDUCE_COL_ROWS <= hi; i += REDUCE_COL_ROWS) {
+        const T *r0 = a.data() + i * stride;
+        const T *r1 = r0 + stride;
+        const T *r2 = r1 + stride;
+        const T *r3 = r2 + stride;
+        T x0 = x[i];
+        T x1 = x[i + 1];
+        T x2 = x[i + 2];
+        T x3 = x[i + 3];
+        for (size_t j = 0; j < n; j++) {
+            acc[j] += x0 * r0[j] + x1 * r1[j] + x2 * r2[j] + x3 * r3[j];
+        }
+    }
+    for (; i < hi; i++) {
+        const T *row = a.data() + i * stride;
+        T xi = x[i];
+        for (size_t j = 0; j < n; j++) {
+            acc[j] += xi * row[j];
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief y = alpha * A^T * x + beta * y, without transposing A
+ *
+ * A is walked row by row, accumulating x[i] times row i into y. For large
+ * matrices the row blocks of `parallel_rows` are accumulated into private
+ * vectors in parallel and then summed.
+ *
+ * @return An error if the lengths of x and y do not match A
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto gemv_transposed(T alpha, const MatrixView<T> &a, std::span<const T> x,
+                     T beta, std::span<T> y) -> std::expected<void, Error> {
+    size_t m = a.nrows();
+    size_t n = a.ncols();
+    if (x.size() != m || y.size() != n) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "cannot multiply the transpose of {}x{} by a vector of {} into "
+            "one of {}",
+            m, n, x.size(), y.size())));
+    }
+    vector<T> acc(n, T{});
+    if (m * n < tuning().gemv_parallel_min || m < 2) {
+        detail::gemv_transposed_range(a, x, 0, m, acc.data());
+    } else {
+        vector<vector<T>> partial(row_blocks(m), vector<T>(n, T{}));
+        parallel_rows(m, [&](size_t block, size_t lo, size_t hi) {
+            detail::gemv_transposed_range(a, x, lo, hi, partial[block].data());
+        });
+        for (const auto &p : partial) {
+            for (size_t j = 0; j < n; j++) {
+                acc[j] += p[j];
+            }
+        }
+    }
+    for (size_t j = 0; j < n; j++) {
+        T value = alpha * acc[j];
+        y[j] = beta == T{} ? value : value + beta * y[j];
+    }
+    return {};
+}
+
+/**
+ * @brief Solves L X = B in place (B is overwritten by X), L lower triangular
+ *
+ * Works row by row on B, so every update is a contiguous row operation.
+ * With `unit_diagonal`, the diagonal of L is taken to be 1 and not read,
+ * which is how L is stored inside an LU factorization.
+ */
+template <std::floating_point T>
+void solve_lower_triangular(const MatrixView<T> &l, MatrixViewMut<T> b,
+                            bool unit_diagonal) {
+    size_t n = l.nrows();
+    size_t cols = b.ncols();
+    for (size_t i = 0; i < n; i++) {
+        T *bi = b.data() + i * b.stride();
+        const T *li = l.data() + i * l.stride();
+        for (size_t r = 0; r < i; r++) {
+            const T *br = b.data() + r * b.stride();
+            T factor = li[r];
+            for (size_t j = 0; j < cols; j++) {
+                bi[j] -= factor * br[j];
+            }
+        }
+        if (!unit_diagonal) {
+            for (size_t j = 0; j < cols; j++) {
+                bi[j] /= li[i];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Solves U X = B in place (B is overwritten by X), U upper triangular
+ */
+template <std::floating_point T>
+void solve_upper_triangular(const MatrixView<T> &u, MatrixViewMut<T> b) {
+    size_t n = u.nrows();
+    size_t cols = b.ncols();
+    for (size_t i = n; i-- > 0;) {
+        T *bi = b.data() + i * b.stride();
+        const T *ui = u.data() + i * u.stride();
+        for (size_t r = i + 1; r < n; r++) {
+            const T *br = b.data() + r * b.stride();
+            T factor = ui[r];
+            for (size_t j = 0; j < cols; j++) {
+                bi[j] -= factor * br[j];
+            }
+        }
+        for (size_t j = 0; j < cols; j++) {
+            bi[j] /= ui[i];
+        }
+    }
+}
+
+/**
+ * @brief In-place LU decomposition with partial pivoting, P A = L U
+ *
+ * Right-looking blocked algorithm. For every panel of `lu_block` columns:
+ *   1. the panel is factored column by column, choosing the largest
+ *      remaining entry of the column as pivot and swapping whole rows; the
+ *      scaling and rank-1 updates of tall panels run in parallel over rows;
+ *   2. the block row to the right of the panel is solved against the panel's
+ *      unit lower triangle (U12 = L11^-1 A12);
+ *   3. the trailing matrix is updated with one `gemm`,
+ *      A22 -= L21 * U12, which is where almost all the flops go.
+ *
+ * On success `a` holds U on and above the diagonal and L (unit diagonal,
+ * not stored) below it.
+ *
+ * @return The pivot rows: row i was swapped with row `pivots[i]` at step i.
+ * An error if `a` is not square or is singular.
+ */
+template <std::floating_point T>
+auto lu_factor(MatrixViewMut<T> a) -> std::expected<vector<size_t>, Error> {
+    size_t n = a.nrows();
+    if (a.ncols() != n) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "LU decomposition needs a square matrix, got {}x{}", n,
+            a.ncols())));
+    }
+    T *base = a.data();
+    size_t lda = a.stride();
+    auto row = [base, lda](size_t i) { return base + i * lda; };
+    vector<size_t> pivots(n);
+    size_t block = tuning().lu_block;
+    size_t parallel_rows = tuning().lu_parallel_rows;
+
+    for (size_t k0 = 0; k0 < n; k0 += block) {
+        size_t k1 = std::min(k0 + block, n);
+
+        // 1. Panel factorization of columns [k0, k1).
+        for (size_t j = k0; j < k1; j++) {
+            size_t p = j;
+            T best = std::abs(row(j)[j]);
+            for (size_t i = j + 1; i < n; i++) {
+                T value = std::abs(row(i)[j]);
+                if (value > best) {
+                    best = value;
+                    p = i;
+                }
+            }
+            if (best == T{}) {
+                return std::unexpected<Error>(Error::SingularMatrix(
+                    std::format("zero pivot in column {}", j)));
+            }
+            pivots[j] = p;
+            if (p != j) {
+                std::swap_ranges(row(j), row(j) + n, row(p));
+            }
+            const T *pivot_row = row(j);
+            T inv_pivot = T{1} / pivot_row[j];
+            auto update = [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; i++) {
+                    T *ri = row(i);
+                    ri[j] *= inv_pivot;
+                    T factor = ri[j];
+                    for (size_t c = j + 1; c < k1; c++) {
+                        ri[c] -= factor * pivot_row[c];
+                    }
+                }
+            };
+            if (n - j - 1 >= parallel_rows) {
+                parallel_for(j + 1, n, parallel_rows / 4, update);
+            } else {
+                update(j + 1, n);
+            }
+        }
+        if (k1 == n) {
+            break;
+        }
+
+        // 2. U12 = L11^-1 A12.
+        solve_lower_triangular(a.view(k0, k0, k1 - k0, k1 - k0),
+                               a.view_mut(k0, k1, k1 - k0, n - k1), true);
+
+        // 3. A22 -= L21 * U12.
+        auto status = gemm(T{-1}, a.view(k1, k0, n - k1, k1 - k0),
+                           a.view(k0, k1, k1 - k0, n - k1), T{1},
+                           a.view_mut(k1, k1, n - k1, n - k1));
+        if (!status) {
+            return std::unexpected<Error>(status.error());
+        }
+    }
+    return pivots;
+}
+
+/**
+ * @brief LU decomposition of a square matrix and the operations built on it
+ */
+template <std::floating_point T> class LuDecomposition {
+  private:
+    Matrix<T> m_lu;
+    vector<size_t> m_pivots;
+
+    LuDecomposition(Matrix<T> lu, vector<size_t> pivots)
+        : m_lu(std::move(lu)), m_pivots(std::move(pivots)) {}
+
+    /// Applies the row interchanges of P to the rows of `b`.
+    void permute_rows(MatrixViewMut<T> b) const {
+        for (size_t i = 0; i < m_pivots.size(); i++) {
+            if (m_pivots[i] != i) {
+                T *ri = b.data() + i * b.stride();
+                T *rp = b.data() + m_pivots[i] * b.stride();
+                std::swap_ranges(ri, ri + b.ncols(), rp);
+            }
+        }
+    }
+
+  public:
+    /**
+     * @brief Factors a copy of `a`
+     * @return The factorization, or an error if `a` is not square or is
+     * singular
+     */
+    static auto factor(const Matrix<T> &a)
+        -> std::expected<LuDecomposition, Error> {
+        Matrix<T> lu(a);
+        auto pivots = lu_factor(lu.view_mut(0, 0, lu.nrows(), lu.ncols()));
+        if (!pivots) {
+            return std::unexpected<Error>(pivots.error());
+        }
+        return LuDecomposition(std::move(lu), std::move(*pivots));
+    }
+
+    [[nodiscard]] const Matrix<T> &lu() const noexcept { return m_lu; }
+    [[nodiscard]] const vector<size_t> &pivots() const noexcept {
+        return m_pivots;
+    }
+
+    /**
+     * @brief Solves A X = B for every column of B
+     */
+    [[nodiscard]] auto solve(const Matrix<T> &b) const
+        -> std::expected<Matrix<T>, Error> {
+        size_t n = m_lu.nrows();
+        if (b.nrows() != n) {
+            return std::unexpected<Error>(Error::InvalidArgument(std::format(
+                "right-hand side has {} rows, expected {}", b.nrows(), n)));
+        }
+        Matrix<T> x(b);
+        auto xv = x.view_mut(0, 0, x.nrows(), x.ncols());
+        auto lu = m_lu.view(0, 0, n, n);
+        permute_rows(xv);
+        solve_lower_triangular(lu, xv, true);
+        solve_upper_triangular(lu, xv);
+        return x;
+    }
+
+    /**
+     * @brief Solves A x = b
+     */
+    [[nodiscard]] auto solve(const vector<T> &b) const
+        -> std::expected<vector<T>, Error> {
+        Matrix<T> rhs(b.size(), 1);
+        std::copy(b.begin(), b.end(), rhs.data());
+        auto x = solve(rhs);
+        if (!x) {
+            return std::unexpected<Error>(x.error());
+        }
+        return vector<T>(x->data(), x->data() + b.size());
+    }
+
+    /// det(A): the product of U's diagonal, negated once per row swap.
+    [[nodiscard]] T determinant() const {
+        T det{1};
+        for (size_t i = 0; i < m_pivots.size(); i++) {
+            det *= m_lu.get_unchecked(i, i);
+            if (m_pivots[i] != i) {
+                det = -det;
+            }
+        }
+        return det;
+    }
+
+    /// A^-1, by solving against the identity.
+    [[nodiscard]] Matrix<T> inverse() const {
+        size_t n = m_lu.nrows();
+        Matrix<T> identity = Matrix<T>::zeros(n, n);
+        for (size_t i = 0; i < n; i++) {
+            identity.get_unchecked(i, i) = T{1};
+        }
+        // The shapes agree by construction.
+        return std::move(*solve(identity));
+    }
+};
+
+#endif // LINALG_HPP
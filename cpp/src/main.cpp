@@ -1,6 +1,34 @@
 #include <print>
+#include <string_view>
 
-int main() {
+#include "autotune.hpp"
+#include "tuning.hpp"
+
+/// Measures the tuning profile of this machine and saves it where `tuning()`
+/// looks for it on the next start.
+int run_autotune() {
+    std::println("Tuning for this machine, this takes a few seconds...");
+    TuningProfile profile = autotune();
+    std::print("{}", profile.to_string());
+    auto path = tuning_profile_path();
+    if (!path) {
+        std::println("Neither {} nor HOME is set; profile not saved",
+                     TUNING_PROFILE_ENV);
+        return 1;
+    }
+    auto saved = save_tuning_profile(profile, *path);
+    if (!saved) {
+        std::println("Error: {}", saved.error().message);
+        return 1;
+    }
+    std::println("Saved to {}", path->string());
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && std::string_view(argv[1]) == "--autotune") {
+        return run_autotune();
+    }
     std::println("hello world!");
     return 0;
 }
@@ -4,10 +4,13 @@
 #include <algorithm>
 #include <cassert>
 #include <concepts>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 #include <utility>
 
+#include "memory.hpp"
+
 // Forward declarations
 template <typename T> class Matrix;
 
@@ -27,20 +30,41 @@ template <typename T> class Matrix {
     size_t m_rows;
     size_t m_cols;
     size_t m_capacity;
+    MemoryPlacement m_placement = MemoryPlacement::FirstTouch;
 
-    void reallocate(size_t new_capacity) {
-        if (new_capacity >
+    static void check_size(size_t size) {
+        if (size >
             static_cast<size_t>(std::numeric_limits<std::ptrdiff_t>::max())) {
             throw std::overflow_error(
                 "Matrix size exceeds maximum allowed size");
         }
+    }
+
+    /// Allocates m_capacity elements without initializing trivial types.
+    void allocate() {
+        m_data = allocate_array<T>(m_capacity, m_placement);
+    }
+
+    void reallocate(size_t new_capacity) {
+        check_size(new_capacity);
 
-        auto new_data = std::make_unique<T[]>(new_capacity);
+        auto new_data = allocate_array<T>(new_capacity, m_placement);
 
         // Copy existing data if any
+        std::size_t copy_size = 0;
         if (m_data && m_capacity > 0) {
-            std::size_t copy_size = std::min(m_capacity, new_capacity);
-            std::move(m_data.get(), m_data.get() + copy_size, new_data.get());
+            copy_size = std::min(m_capacity, new_capacity);
+            if constexpr (TriviallyInitializable<T>) {
+                parallel_copy(m_data.get(), copy_size, new_data.get(),
+                              std::max<size_t>(m_cols, 1));
+            } else {
+                std::move(m_data.get(), m_data.get() + copy_size,
+                          new_data.get());
+            }
+        }
+        if constexpr (TriviallyInitializable<T>) {
+            parallel_fill(new_data.get() + copy_size, new_capacity - copy_size,
+                          T{});
         }
 
         m_data = std::move(new_data);
@@ -55,33 +79,45 @@ template <typename T> class Matrix {
      * @param cols Number of columns
      */
     explicit Matrix(size_t rows, size_t cols) : m_rows(rows), m_cols(cols) {
-        size_t size = rows * cols;
-        if (size >
-            static_cast<size_t>(std::numeric_limits<std::ptrdiff_t>::max())) {
-            throw std::overflow_error(
-                "Matrix size exceeds maximum allowed size");
+        m_capacity = rows * cols;
+        check_size(m_capacity);
+        allocate();
+        if constexpr (TriviallyInitializable<T>) {
+            parallel_fill(m_data.get(), m_capacity, T{},
+                          std::max<size_t>(cols, 1));
         }
-        m_capacity = size;
-        m_data = std::make_unique<T[]>(m_capacity);
     }
 
     /**
      * @brief Construct a matrix filled with a specific value
      *
+     * Large matrices are filled in parallel, each worker writing one block
+     * of rows, so on a NUMA machine the pages of a block sit on the node of
+     * the worker that the row kernels later give it to (see `placement`
+     * and `parallel_rows`).
+     *
      * @param rows Number of rows
      * @param cols Number of columns
      * @param value Value to fill the matrix with
+     * @param placement Where the pages go on a NUMA machine
      */
-    Matrix(size_t rows, size_t cols, const T &value) : Matrix(rows, cols) {
-        std::fill_n(m_data.get(), m_capacity, value);
+    Matrix(size_t rows, size_t cols, const T &value,
+           MemoryPlacement placement = MemoryPlacement::FirstTouch)
+        : m_rows(rows), m_cols(cols), m_capacity(rows * cols),
+          m_placement(placement) {
+        check_size(m_capacity);
+        allocate();
+        parallel_fill(m_data.get(), m_capacity, value,
+                      std::max<size_t>(cols, 1));
     }
 
     // Rule of 5
     Matrix(const Matrix &other)
         : m_rows(other.m_rows), m_cols(other.m_cols),
-          m_capacity(other.m_capacity) {
-        m_data = std::make_unique<T[]>(m_capacity);
-        std::copy_n(other.m_data.get(), m_capacity, m_data.get());
+          m_capacity(other.m_capacity), m_placement(other.m_placement) {
+        allocate();
+        parallel_copy(other.m_data.get(), m_capacity, m_data.get(),
+                      std::max<size_t>(m_cols, 1));
     }
 
     Matrix &operator=(const Matrix &other) {
@@ -102,6 +138,7 @@ template <typename T> class Matrix {
         swap(m_rows, other.m_rows);
         swap(m_cols, other.m_cols);
         swap(m_capacity, other.m_capacity);
+        swap(m_placement, other.m_placement);
     }
 
     // Accessors
@@ -111,6 +148,11 @@ template <typename T> class Matrix {
         return {m_rows, m_cols};
     }
 
+    /// Placement of the pages; copies and reallocations keep it.
+    [[nodiscard]] MemoryPlacement placement() const noexcept {
+        return m_placement;
+    }
+
     /**
      * @brief Safe element access with bounds checking
      */
@@ -144,21 +186,21 @@ template <typename T> class Matrix {
         return m_data[row * m_cols + col];
     }
 
-    [[nodiscard]] T &at(size_t row, size_t col) noexcept {
+    [[nodiscard]] T &at(size_t row, size_t col) {
         if (row >= m_rows || col >= m_cols) {
             throw std::out_of_range("Matrix indices out of bounds");
         }
         return m_data[row * m_cols + col];
     }
 
-    [[nodiscard]] const T &at(size_t row, size_t col) const noexcept {
+    [[nodiscard]] const T &at(size_t row, size_t col) const {
         if (row >= m_rows || col >= m_cols) {
             throw std::out_of_range("Matrix indices out of bounds");
         }
         return m_data[row * m_cols + col];
     }
 
-    [[nodiscard]] const T &operator()(size_t row, size_t col) const noexcept {
+    [[nodiscard]] const T &operator()(size_t row, size_t col) const {
         return at(row, col);
     }
 
@@ -202,8 +244,10 @@ template <typename T> class Matrix {
 
     template <typename U = T>
         requires std::default_initializable<U>
-    [[nodiscard]] static Matrix<U> zeros(size_t rows, size_t cols) {
-        return Matrix<U>(rows, cols, U{});
+    [[nodiscard]] static Matrix<U>
+    zeros(size_t rows, size_t cols,
+          MemoryPlacement placement = MemoryPlacement::FirstTouch) {
+        return Matrix<U>(rows, cols, U{}, placement);
     }
 
     template <typename U = T>
@@ -220,6 +264,9 @@ template <typename T> class Matrix {
 
     [[nodiscard]] const T *data() const noexcept { return m_data.get(); }
     [[nodiscard]] T *data() noexcept { return m_data.get(); }
+
+    /// Distance in elements between the starts of consecutive rows.
+    [[nodiscard]] size_t stride() const noexcept { return m_cols; }
 };
 
 template <typename T> class MatrixView {
@@ -243,6 +290,16 @@ template <typename T> class MatrixView {
         return {m_rows, m_cols};
     }
 
+    /**
+     * @brief Pointer to the view's first element
+     *
+     * Row i of the view starts at `data() + i * stride()`.
+     */
+    [[nodiscard]] const T *data() const noexcept {
+        return m_parent->data() + m_row_offset * m_parent_cols + m_col_offset;
+    }
+    [[nodiscard]] size_t stride() const noexcept { return m_parent_cols; }
+
     [[nodiscard]] const T *get(size_t row, size_t col) const noexcept {
         if (row >= m_rows || col >= m_cols) {
             return nullptr;
@@ -312,6 +369,19 @@ template <typename T> class MatrixViewMut {
         return {m_rows, m_cols};
     }
 
+    /**
+     * @brief Pointer to the view's first element
+     *
+     * Row i of the view starts at `data() + i * stride()`.
+     */
+    [[nodiscard]] const T *data() const noexcept {
+        return m_parent->data() + m_row_offset * m_parent_cols + m_col_offset;
+    }
+    [[nodiscard]] T *data() noexcept {
+        return m_parent->data() + m_row_offset * m_parent_cols + m_col_offset;
+    }
+    [[nodiscard]] size_t stride() const noexcept { return m_parent_cols; }
+
     [[nodiscard]] const T *get(size_t row, size_t col) const noexcept {
         if (row >= m_rows || col >= m_cols) {
             return nullptr;
@@ -0,0 +1,299 @@
+#ifndef MATRIX_POWER_HPP
+#define MATRIX_POWER_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "error.hpp"
+#include "linalg.hpp"
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "tuning.hpp"
+
+using std::vector;
+
+namespace detail {
+
+template <typename T> auto square_error(const Matrix<T> &m) -> Error {
+    return Error::InvalidArgument(std::format(
+        "matrix power needs a square matrix, got {}x{}", m.nrows(), m.ncols()));
+}
+
+/// C = A * B for square matrices of equal size, C distinct from A and B.
+template <typename T>
+    requires std::is_arithmetic_v<T>
+void multiply_into(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c) {
+    size_t n = a.nrows();
+    // Shapes agree by construction.
+    (void)gemm(T{1}, a.view(0, 0, n, n), b.view(0, 0, n, n), T{},
+               c.view_mut(0, 0, n, n));
+}
+
+/// C = A * B mod `modulus`, entries of A and B already reduced.
+inline void multiply_mod_into(const Matrix<uint64_t> &a,
+                              const Matrix<uint64_t> &b, Matrix<uint64_t> &c,
+                              uint64_t modulus) {
+    size_t n = a.nrows();
+    // With a 32-bit modulus every product is below 2^64, so a row of 128-bit
+    // accumulators absorbs all n of them and is reduced once at the end.
+    bool reduce_once = modulus <= (uint64_t{1} << 32);
+    auto body = [&](size_t lo, size_t hi) {
+        vector<unsigned __int128> acc(n);
+        for (size_t i = lo; i < hi; i++) {
+            std::fill(acc.begin(), acc.end(), 0);
+            const uint64_t *arow = a.data() + i * n;
+            for (size_t p = 0; p < n; p++) {
+                unsigned __int128 aip = arow[p];
+                if (aip == 0) {
+                    continue;
+                }
+                const uint64_t *brow = b.data() + p * n;
+                if (reduce_once) {
+                    for (size_t j = 0; j < n; j++) {
+                        acc[j] += aip * brow[j];
+                    }
+                } else {
+                    for (size_t j = 0; j < n; j++) {
+                        acc[j] += aip * brow[j] % modulus;
+                    }
+                }
+            }
+            uint64_t *crow = c.data() + i * n;
+            for (size_t j = 0; j < n; j++) {
+                crow[j] = static_cast<uint64_t>(acc[j] % modulus);
+            }
+        }
+    };
+    if (n <= tuning().gemm_row_grain) {
+        body(0, n);
+    } else {
+        parallel_rows(n, [&](size_t, size_t lo, size_t hi) { body(lo, hi); });
+    }
+}
+
+/**
+ * Binary exponentiation with three buffers: the running result, the running
+ * square and one scratch matrix. Every product is written into the scratch
+ * buffer and then swapped in (Matrix::swap only exchanges pointers), so no
+ * matrix is allocated inside the loop.
+ */
+template <typename T, typename Multiply>
+auto power_by_squaring(const Matrix<T> &m, uint64_t k, T one,
+                       Multiply multiply) -> Matrix<T> {
+    size_t n = m.nrows();
+    Matrix<T> result = Matrix<T>::zeros(n, n);
+    for (size_t i = 0; i < n; i++) {
+        result.get_unchecked(i, i) = one;
+    }
+    Matrix<T> base(m);
+    Matrix<T> scratch(n, n);
+    while (k > 0) {
+        if (k & 1) {
+            multiply(result, base, scratch);
+            result.swap(scratch);
+        }
+        k >>= 1;
+        if (k > 0) {
+            multiply(base, base, scratch);
+            base.swap(scratch);
+        }
+    }
+    return result;
+}
+
+} // namespace detail
+
+/**
+ * @brief M^k by repeated squaring, in O(n^3 log k)
+ * @return M^k (the identity for k = 0), or an error if M is not square
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto matrix_power(const Matrix<T> &m, uint64_t k)
+    -> std::expected<Matrix<T>, Error> {
+    if (m.nrows() != m.ncols()) {
+        return std::unexpected<Error>(detail::square_error(m));
+    }
+    return detail::power_by_squaring(m, k, T{1}, [](const auto &a,
+                                                    const auto &b, auto &c) {
+        detail::multiply_into(a, b, c);
+    });
+}
+
+/**
+ * @brief M^k mod `modulus`, exact for any 64-bit modulus
+ *
+ * For counting problems (paths of length k, linear recurrences mod p):
+ * products are accumulated in 128-bit integers.
+ */
+inline auto matrix_power_mod(const Matrix<uint64_t> &m, uint64_t k,
+                             uint64_t modulus)
+    -> std::expected<Matrix<uint64_t>, Error> {
+    if (m.nrows() != m.ncols()) {
+        return std::unexpected<Error>(detail::square_error(m));
+    }
+    if (modulus == 0) {
+        return std::unexpected<Error>(
+            Error::InvalidArgument("the modulus must be positive"));
+    }
+    Matrix<uint64_t> reduced(m);
+    for (size_t i = 0; i < m.nrows() * m.ncols(); i++) {
+        reduced.data()[i] %= modulus;
+    }
+    return detail::power_by_squaring(
+        reduced, k, uint64_t{1} % modulus,
+        [modulus](const auto &a, const auto &b, auto &c) {
+            detail::multiply_mod_into(a, b, c, modulus);
+        });
+}
+
+/**
+ * @brief Repeated squares M, M^2, M^4, ... of one matrix, kept for reuse
+ *
+ * v * M^k is evaluated as a product of v with the squares for the set bits
+ * of k: O(n^2 log k) per vector once the squares exist, instead of
+ * O(n^3 log k). Squares are computed on demand and cached, so many vectors
+ * and many exponents share them.
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+class MatrixPowerCache {
+  private:
+    vector<Matrix<T>> m_squares;
+
+    void ensure_squares(uint64_t k) {
+        size_t needed = std::bit_width(k);
+        while (m_squares.size() < needed) {
+            const Matrix<T> &last = m_squares.back();
+            Matrix<T> next(last.nrows(), last.ncols());
+            detail::multiply_into(last, last, next);
+            m_squares.push_back(std::move(next));
+        }
+    }
+
+    explicit MatrixPowerCache(const Matrix<T> &m) { m_squares.push_back(m); }
+
+  public:
+    /**
+     * @brief Creates a cache for `m`
+     * @return The cache, or an error if `m` is not square
+     */
+    static auto create(const Matrix<T> &m)
+        -> std::expected<MatrixPowerCache, Error> {
+        if (m.nrows() != m.ncols()) {
+            return std::unexpected<Error>(detail::square_error(m));
+        }
+        return MatrixPowerCache(m);
+    }
+
+    [[nodiscard]] size_t dim() const noexcept {
+        return m_squares.front().nrows();
+    }
+
+    /**
+     * @brief Row vector v times M^k
+     */
+    auto vector_power(const vector<T> &v, uint64_t k)
+        -> std::expected<vector<T>, Error> {
+        size_t n = dim();
+        if (v.size() != n) {
+            return std::unexpected<Error>(Error::InvalidArgument(std::format(
+                "vector of length {} for a {}x{} matrix", v.size(), n, n)));
+        }
+        ensure_squares(k);
+        vector<T> x = v;
+        vector<T> y(n);
+        for (size_t bit = 0; (k >> bit) != 0; bit++) {
+            if (((k >> bit) & 1) == 0) {
+                continue;
+            }
+            const Matrix<T> &s = m_squares[bit];
+            std::fill(y.begin(), y.end(), T{});
+            for (size_t p = 0; p < n; p++) {
+                T xp = x[p];
+                const T *row = s.data() + p * n;
+                for (size_t j = 0; j < n; j++) {
+                    y[j] += xp * row[j];
+                }
+            }
+            x.swap(y);
+        }
+        return x;
+    }
+
+    /**
+     * @brief Every row of `vectors` times M^k, as one batch
+     *
+     * Each set bit of k costs one `gemm` of the whole batch with the cached
+     * square, ping-ponging between two batch buffers.
+     */
+    auto batch_power(const Matrix<T> &vectors, uint64_t k)
+        -> std::expected<Matrix<T>, Error> {
+        size_t n = dim();
+        if (vectors.ncols() != n) {
+            return std::unexpected<Error>(Error::InvalidArgument(std::format(
+                "vectors of length {} for a {}x{} matrix", vectors.ncols(), n,
+                n)));
+        }
+        ensure_squares(k);
+        size_t rows = vectors.nrows();
+        Matrix<T> x(vectors);
+        Matrix<T> y(rows, n);
+        for (size_t bit = 0; (k >> bit) != 0; bit++) {
+            if (((k >> bit) & 1) == 0) {
+                continue;
+            }
+            const Matrix<T> &s = m_squares[bit];
+            (void)gemm(T{1}, x.view(0, 0, rows, n), s.view(0, 0, n, n), T{},
+                       y.view_mut(0, 0, rows, n));
+            x.swap(y);
+        }
+        return x;
+    }
+};
+
+/**
+ * @brief n-th term of a linear recurrence
+ *
+ * a_i = coeffs[0] * a_{i-1} + coeffs[1] * a_{i-2} + ... for i >= d, with
+ * a_0 .. a_{d-1} given by `initial` (d = coeffs.size()). Evaluated as the
+ * initial state vector times the (n - d + 1)-th power of the companion
+ * matrix, in O(d^3 log n).
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto linear_recurrence(const vector<T> &coeffs, const vector<T> &initial,
+                       uint64_t n) -> std::expected<T, Error> {
+    size_t d = coeffs.size();
+    if (d == 0 || initial.size() != d) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "{} coefficients need as many initial terms, got {}", d,
+            initial.size())));
+    }
+    if (n < d) {
+        return initial[n];
+    }
+    // State s_t = [a_{t+d-1}, ..., a_t]; s_{t+1} = s_t * C.
+    Matrix<T> companion = Matrix<T>::zeros(d, d);
+    for (size_t p = 0; p < d; p++) {
+        companion.get_unchecked(p, 0) = coeffs[p];
+        if (p + 1 < d) {
+            companion.get_unchecked(p, p + 1) = T{1};
+        }
+    }
+    vector<T> state(initial.rbegin(), initial.rend());
+    auto cache = MatrixPowerCache<T>::create(companion);
+    auto result = cache->vector_power(state, n - d + 1);
+    if (!result) {
+        return std::unexpected<Error>(result.error());
+    }
+    return (*result)[0];
+}
+
+#endif // MATRIX_POWER_HPP
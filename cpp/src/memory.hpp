@@ -0,0 +1,288 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "parallel.hpp"
+#include "tuning.hpp"
+
+using std::vector;
+
+/**
+ * @brief Where the pages of a large allocation go on a NUMA machine
+ */
+enum class MemoryPlacement {
+    /// Each page goes to the node of the thread that first writes it. Large
+    /// matrices are initialized one block of rows per worker, and the row
+    /// kernels process the same blocks on the same workers through
+    /// `parallel_rows`, so each block is used on the node that holds it.
+    FirstTouch,
+    /// Every page on the node of the allocating thread.
+    Local,
+    /// Pages spread round-robin over all nodes, for data every thread
+    /// reads with no affinity.
+    Interleave,
+};
+
+/// Types allocated without initialization and written with plain stores.
+template <typename T>
+concept TriviallyInitializable = std::is_trivially_default_constructible_v<T> &&
+                                 std::is_trivially_copyable_v<T>;
+
+namespace detail {
+
+inline auto numa_node_count() -> size_t {
+    static const size_t count = numa_node_cpus().size();
+    return count;
+}
+
+/**
+ * Applies `placement` to the whole pages inside [p, p + bytes) with mbind.
+ * Must run before the pages are first touched. Best effort: a single-node
+ * machine, another OS or a refused system call leaves the default policy.
+ */
+inline void place_pages(void *p, size_t bytes, MemoryPlacement placement) {
+#if defined(__linux__) && defined(SYS_mbind)
+    size_t nodes = numa_node_count();
+    if (placement == MemoryPlacement::FirstTouch || nodes < 2) {
+        return;
+    }
+    // From <linux/mempolicy.h>.
+    constexpr int MPOL_PREFERRED = 1;
+    constexpr int MPOL_INTERLEAVE = 3;
+    constexpr size_t WORD_BITS = 8 * sizeof(unsigned long);
+
+    auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    auto first = (reinterpret_cast<uintptr_t>(p) + page - 1) & ~(page - 1);
+    auto last = (reinterpret_cast<uintptr_t>(p) + bytes) & ~(page - 1);
+    if (first >= last) {
+        return;
+    }
+    vector<unsigned long> mask((nodes + WORD_BITS - 1) / WORD_BITS, 0);
+    int mode = MPOL_INTERLEAVE;
+    if (placement == MemoryPlacement::Local) {
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 || node >= nodes) {
+            return;
+        }
+        mask[node / WORD_BITS] |= 1UL << (node % WORD_BITS);
+        mode = MPOL_PREFERRED;
+    } else {
+        for (size_t node = 0; node < nodes; node++) {
+            mask[node / WORD_BITS] |= 1UL << (node % WORD_BITS);
+        }
+    }
+    // The kernel reads maxnode - 1 bits of the mask.
+    syscall(SYS_mbind, first, last - first, mode, mask.data(),
+            mask.size() * WORD_BITS + 1, 0);
+#else
+    (void)p;
+    (void)bytes;
+    (void)placement;
+#endif
+}
+
+#if defined(__AVX2__)
+
+/// Whether `stream_fill` and `stream_copy` handle T at `p`: whole elements
+/// per 32-byte register, and `p` aligned so that a register boundary is
+/// reached after whole elements.
+template <typename T> bool streamable(const T *p) {
+    if constexpr (std::is_trivially_copyable_v<T> && 32 % sizeof(T) == 0) {
+        return reinterpret_cast<uintptr_t>(p) % sizeof(T) == 0;
+    } else {
+        return false;
+    }
+}
+
+/// Elements before the first 32-byte boundary at or after `p`, capped at n.
+template <typename T> auto stream_head(const T *p, size_t n) -> size_t {
+    size_t misalignment = reinterpret_cast<uintptr_t>(p) % 32;
+    return std::min(n, misalignment == 0 ? 0 : (32 - misalignment) / sizeof(T));
+}
+
+/// Fills [p, p + n) with `value`, whole registers through streaming stores.
+template <typename T> void stream_fill(T *p, size_t n, const T &value) {
+    size_t head = stream_head(p, n);
+    std::fill_n(p, head, value);
+    T pattern[32 / sizeof(T)];
+    std::fill_n(pattern, 32 / sizeof(T), value);
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pattern));
+    size_t i = head;
+    for (; i + 32 / sizeof(T) <= n; i += 32 / sizeof(T)) {
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(p + i), v);
+    }
+    std::fill_n(p + i, n - i, value);
+    _mm_sfence();
+}
+
+/// Copies [src, src + n) to `dst`, writing whole registers through
+/// streaming stores.
+template <typename T> void stream_copy(const T *src, size_t n, T *dst) {
+    size_t head = stream_head(dst, n);
+    std::copy_n(src, head, dst);
+    size_t i = head;
+    for (; i + 32 / sizeof(T) <= n; i += 32 / sizeof(T)) {
+        __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + i), v);
+    }
+    std::copy_n(src + i, n - i, dst + i);
+    _mm_sfence();
+}
+
+#endif
+
+template <typename T>
+void fill_range(T *p, size_t n, const T &value, bool stream) {
+#if defined(__AVX2__)
+    if (stream && streamable(p)) {
+        stream_fill(p, n, value);
+        return;
+    }
+#endif
+    (void)stream;
+    std::fill_n(p, n, value);
+}
+
+template <typename T>
+void copy_range(const T *src, size_t n, T *dst, bool stream) {
+#if defined(__AVX2__)
+    if (stream && streamable(dst)) {
+        stream_copy(src, n, dst);
+        return;
+    }
+#endif
+    (void)stream;
+    std::copy_n(src, n, dst);
+}
+
+} // namespace detail
+
+/**
+ * @brief Fills [p, p + n) with `value`, in parallel for large ranges
+ *
+ * The range is cut into blocks of `unit` elements (a matrix row) and the
+ * blocks are split evenly over the workers with `parallel_for_static`, so
+ * each worker writes, and first touches, one contiguous share. Ranges of at
+ * least `tuning().stream_store_min_bytes` bypass the cache with streaming
+ * stores; ranges below `tuning().parallel_init_min_bytes` are written by the
+ * calling thread.
+ * `pool` defaults to the default pool, which small ranges never touch.
+ */
+template <typename T>
+void parallel_fill(T *p, size_t n, const T &value, size_t unit = 1,
+                   ThreadPool *pool = nullptr) {
+    size_t bytes = n * sizeof(T);
+    bool stream = bytes >= tuning().stream_store_min_bytes;
+    if (bytes < tuning().parallel_init_min_bytes) {
+        detail::fill_range(p, n, value, stream);
+        return;
+    }
+    unit = std::max<size_t>(unit, 1);
+    parallel_for_static(
+        0, (n + unit - 1) / unit,
+        [&](size_t lo, size_t hi) {
+            size_t first = lo * unit;
+            size_t last = std::min(n, hi * unit);
+            detail::fill_range(p + first, last - first, value, stream);
+        },
+        pool != nullptr ? *pool : default_pool());
+}
+
+/**
+ * @brief Copies [src, src + n) to `dst`, in parallel for large ranges
+ *
+ * Partitioned like `parallel_fill`. The ranges must not overlap.
+ */
+template <typename T>
+void parallel_copy(const T *src, size_t n, T *dst, size_t unit = 1,
+                   ThreadPool *pool = nullptr) {
+    size_t bytes = n * sizeof(T);
+    bool stream = bytes >= tuning().stream_store_min_bytes;
+    if (bytes < tuning().parallel_init_min_bytes) {
+        detail::copy_range(src, n, dst, stream);
+        return;
+    }
+    unit = std::max<size_t>(unit, 1);
+    parallel_for_static(
+        0, (n + unit - 1) / unit,
+        [&](size_t lo, size_t hi) {
+            size_t first = lo * unit;
+            size_t last = std::min(n, hi * unit);
+            detail::copy_range(src + first, last - first, dst + first, stream);
+        },
+        pool != nullptr ? *pool : default_pool());
+}
+
+/**
+ * @brief Number of blocks `parallel_rows` cuts `rows` rows into: one per
+ * worker of `pool` (the default pool if null), or one per row if there are
+ * fewer rows than workers
+ */
+inline auto row_blocks(size_t rows, ThreadPool *pool = nullptr) -> size_t {
+    ThreadPool &p = pool != nullptr ? *pool : default_pool();
+    return std::min(rows, p.num_workers());
+}
+
+/**
+ * @brief Calls `body(block, lo, hi)` for every block of rows [lo, hi) of a
+ * matrix with `rows` rows
+ *
+ * Block w is run on worker w of `pool`, and the blocks are the ones
+ * `parallel_fill` and `parallel_copy` initialize a matrix with (with `unit`
+ * set to the row length). Under FirstTouch placement every worker of a
+ * pinned pool therefore works on rows whose pages sit on its own node.
+ * `block` counts from 0 to `row_blocks(rows, pool)`, for kernels that keep
+ * one partial result per block.
+ */
+template <typename F>
+void parallel_rows(size_t rows, F &&body, ThreadPool *pool = nullptr) {
+    ThreadPool &p = pool != nullptr ? *pool : default_pool();
+    size_t blocks = row_blocks(rows, &p);
+    parallel_for_static(
+        0, blocks,
+        [&](size_t lo, size_t hi) {
+            for (size_t b = lo; b < hi; b++) {
+                body(b, rows * b / blocks, rows * (b + 1) / blocks);
+            }
+        },
+        p);
+}
+
+/**
+ * @brief Allocates `n` elements whose pages follow `placement`
+ *
+ * TriviallyInitializable types are left uninitialized, so no page is
+ * touched before the caller's (parallel) initialization. Other types are
+ * value-initialized by the calling thread, which also places their pages.
+ */
+template <typename T>
+auto allocate_array(size_t n, MemoryPlacement placement)
+    -> std::unique_ptr<T[]> {
+    if constexpr (TriviallyInitializable<T>) {
+        auto data = std::make_unique_for_overwrite<T[]>(n);
+        detail::place_pages(data.get(), n * sizeof(T), placement);
+        return data;
+    } else {
+        (void)placement;
+        return std::make_unique<T[]>(n);
+    }
+}
+
+#endif // MEMORY_HPP
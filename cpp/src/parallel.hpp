@@ -0,0 +1,615 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <expected>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "error.hpp"
+
+using std::vector;
+
+/// Upper bound on the number of workers a pool may be configured with.
+inline constexpr size_t MAX_POOL_THREADS = 256;
+
+/**
+ * @brief Callbacks invoked by pool workers, for profiling and diagnostics
+ *
+ * Hooks run on the worker thread that triggered them and must be cheap and
+ * thread-safe.
+ */
+struct ThreadPoolHooks {
+    /// Called after worker `thief` took a task from worker `victim`'s deque.
+    std::function<void(size_t thief, size_t victim)> on_steal = {};
+    /// Called when worker `worker` resumes after sleeping for `idle`.
+    std::function<void(size_t worker, std::chrono::nanoseconds idle)>
+        on_idle = {};
+};
+
+/**
+ * @brief Configuration of a ThreadPool
+ */
+struct ThreadPoolConfig {
+    /// Number of workers; 0 means one per hardware thread.
+    size_t num_threads = 0;
+    /// Pin every worker to one CPU, spreading workers across NUMA nodes
+    /// round-robin so that consecutive workers land on different nodes.
+    bool pin_threads = false;
+    ThreadPoolHooks hooks = {};
+};
+
+/**
+ * @brief Per-worker counters, as returned by ThreadPool::stats()
+ */
+struct WorkerStats {
+    uint64_t tasks_executed = 0; ///< Tasks run by this worker
+    uint64_t steals = 0; ///< Tasks taken from other workers' deques
+    std::chrono::nanoseconds idle_time{0}; ///< Total time spent asleep
+};
+
+namespace detail {
+
+/**
+ * CPUs of every NUMA node, read from sysfs. Falls back to a single node
+ * holding all CPUs when the topology is not available.
+ */
+inline auto numa_node_cpus() -> vector<vector<int>> {
+    vector<vector<int>> nodes;
+#if defined(__linux__)
+    for (int node = 0;; node++) {
+        std::ifstream file(std::format(
+            "/sys/devices/system/node/node{}/cpulist", node));
+        if (!file) {
+            break;
+        }
+        // Format: comma-separated CPUs or ranges, e.g. "0-3,8-11".
+        vector<int> cpus;
+        std::string item;
+        while (std::getline(file, item, ',')) {
+            size_t dash = item.find('-');
+            try {
+                int first = std::stoi(item.substr(0, dash));
+                int last = dash == std::string::npos
+                               ? first
+                               : std::stoi(item.substr(dash + 1));
+                for (int cpu = first; cpu <= last; cpu++) {
+                    cpus.push_back(cpu);
+                }
+            } catch (const std::exception &) {
+                // Ignore malformed entries.
+            }
+        }
+        if (!cpus.empty()) {
+            nodes.push_back(std::move(cpus));
+        }
+    }
+#endif
+    if (nodes.empty()) {
+        vector<int> all(std::max(1u, std::thread::hardware_concurrency()));
+        for (size_t i = 0; i < all.size(); i++) {
+            all[i] = static_cast<int>(i);
+        }
+        nodes.push_back(std::move(all));
+    }
+    return nodes;
+}
+
+/// Pins the calling thread to `cpu`. Best effort: failures are ignored.
+inline void pin_current_thread(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+} // namespace detail
+
+/**
+ * @brief Work-stealing thread pool shared by all parallel algorithms
+ *
+ * Every worker owns a deque. Tasks submitted from a worker go to the back of
+ * its own deque and are popped from the back (LIFO, cache-warm); idle
+ * workers steal from the front of other deques (FIFO, the oldest and
+ * usually largest pieces of work). Tasks submitted from outside the pool are
+ * distributed round-robin. Workers with nothing to do sleep on a condition
+ * variable.
+ *
+ * Use TaskGroup for fork/join and parallel_for for loops rather than
+ * submitting raw tasks.
+ */
+class ThreadPool {
+  public:
+    using Task = std::function<void()>;
+
+  private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::atomic<uint64_t> tasks_executed{0};
+        std::atomic<uint64_t> steals{0};
+        std::atomic<int64_t> idle_ns{0};
+        std::thread thread;
+    };
+
+    static constexpr size_t NOT_A_WORKER = static_cast<size_t>(-1);
+
+    ThreadPoolConfig m_config;
+    vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t> m_pending{0};
+    std::atomic<size_t> m_next_victim{0};
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    struct Current {
+        const ThreadPool *pool = nullptr;
+        size_t index = NOT_A_WORKER;
+    };
+
+    static Current &current() {
+        thread_local Current current;
+        return current;
+    }
+
+    explicit ThreadPool(ThreadPoolConfig config) : m_config(std::move(config)) {
+        size_t n = m_config.num_threads;
+        m_workers.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            m_workers.push_back(std::make_unique<Worker>());
+        }
+        vector<vector<int>> nodes;
+        if (m_config.pin_threads) {
+            nodes = detail::numa_node_cpus();
+        }
+        for (size_t i = 0; i < n; i++) {
+            int cpu = -1;
+            if (!nodes.empty()) {
+                const auto &node = nodes[i % nodes.size()];
+                cpu = node[(i / nodes.size()) % node.size()];
+            }
+            m_workers[i]->thread =
+                std::thread([this, i, cpu] { worker_loop(i, cpu); });
+        }
+    }
+
+    /// This thread's worker index in this pool, or NOT_A_WORKER.
+    [[nodiscard]] size_t worker_index() const noexcept {
+        const Current &cur = current();
+        return cur.pool == this ? cur.index : NOT_A_WORKER;
+    }
+
+    /// Pops a task: own deque first (back), then steals (front) from the
+    /// others, starting after `self`.
+    auto find_task(size_t self, Task &task) -> bool {
+        size_t n = m_workers.size();
+        if (self != NOT_A_WORKER) {
+            Worker &own = *m_workers[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                m_pending.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        size_t start = self == NOT_A_WORKER
+                           ? m_next_victim.load(std::memory_order_relaxed)
+                           : self + 1;
+        for (size_t offset = 0; offset < n; offset++) {
+            size_t victim = (start + offset) % n;
+            if (victim == self) {
+                continue;
+            }
+            Worker &other = *m_workers[victim];
+            std::unique_lock<std::mutex> lock(other.mutex);
+            if (other.tasks.empty()) {
+                continue;
+            }
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            lock.unlock();
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            if (self != NOT_A_WORKER) {
+                m_workers[self]->steals.fetch_add(1,
+                                                  std::memory_order_relaxed);
+                if (m_config.hooks.on_steal) {
+                    m_config.hooks.on_steal(self, victim);
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void run(size_t self, Task &task) {
+        task();
+        if (self != NOT_A_WORKER) {
+            m_workers[self]->tasks_executed.fetch_add(
+                1, std::memory_order_relaxed);
+        }
+    }
+
+    void push(size_t target, Task task) {
+        {
+            Worker &worker = *m_workers[target];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            // Pairs with the predicate check in worker_loop so that the
+            // wake-up cannot be lost.
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        }
+    }
+
+    void worker_loop(size_t index, int cpu) {
+        current() = {this, index};
+        if (cpu >= 0) {
+            detail::pin_current_thread(cpu);
+        }
+        Worker &self = *m_workers[index];
+        for (;;) {
+            Task task;
+            if (find_task(index, task)) {
+                run(index, task);
+                continue;
+            }
+            auto start = std::chrono::steady_clock::now();
+            {
+                std::unique_lock<std::mutex> lock(m_sleep_mutex);
+                m_wake.wait(lock, [this] {
+                    return m_stop ||
+                           m_pending.load(std::memory_order_relaxed) > 0;
+                });
+                if (m_stop && m_pending.load(std::memory_order_relaxed) == 0) {
+                    return;
+                }
+            }
+            auto idle = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start);
+            self.idle_ns.fetch_add(idle.count(), std::memory_order_relaxed);
+            if (m_config.hooks.on_idle) {
+                m_config.hooks.on_idle(index, idle);
+            }
+        }
+    }
+
+  public:
+    /**
+     * @brief Creates a pool and starts its workers
+     * @param config Pool configuration; `num_threads` must not exceed
+     * MAX_POOL_THREADS
+     * @return The pool, or an error describing the invalid configuration
+     */
+    static auto create(ThreadPoolConfig config = {})
+        -> std::expected<std::unique_ptr<ThreadPool>, Error> {
+        if (config.num_threads == 0) {
+            config.num_threads = std::clamp<size_t>(
+                std::thread::hardware_concurrency(), 1, MAX_POOL_THREADS);
+        }
+        if (config.num_threads > MAX_POOL_THREADS) {
+            return std::unexpected<Error>(Error::InvalidArgument(std::format(
+                "a pool supports at most {} threads, but {} were requested",
+                MAX_POOL_THREADS, config.num_threads)));
+        }
+        return std::unique_ptr<ThreadPool>(new ThreadPool(std::move(config)));
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /// Runs every queued task, then stops and joins the workers.
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto &worker : m_workers) {
+            worker->thread.join();
+        }
+    }
+
+    [[nodiscard]] size_t num_workers() const noexcept {
+        return m_workers.size();
+    }
+
+    /**
+     * @brief Queues a task for execution
+     *
+     * Called from a worker of this pool, the task goes to that worker's own
+     * deque; otherwise it is handed to the workers round-robin. The task
+     * must not throw; TaskGroup wraps its tasks accordingly.
+     */
+    void submit(Task task) {
+        size_t self = worker_index();
+        size_t target =
+            self != NOT_A_WORKER
+                ? self
+                : m_next_victim.fetch_add(1, std::memory_order_relaxed) %
+                      m_workers.size();
+        push(target, std::move(task));
+        m_wake.notify_one();
+    }
+
+    /**
+     * @brief Queues a task on the deque of worker `worker % num_workers()`
+     *
+     * Every sleeping worker is woken, so that the owner picks the task up
+     * from its own deque; another worker only gets it by stealing once its
+     * own deque is empty.
+     */
+    void submit_to(size_t worker, Task task) {
+        push(worker % m_workers.size(), std::move(task));
+        m_wake.notify_all();
+    }
+
+    /// Whether the calling thread is one of this pool's workers.
+    [[nodiscard]] bool is_worker() const noexcept {
+        return worker_index() != NOT_A_WORKER;
+    }
+
+    /**
+     * @brief Runs one queued task on the calling thread, if there is one
+     * @return Whether a task was run
+     *
+     * Used by threads that wait for other tasks, so that waiting never
+     * leaves a core idle and never deadlocks a pool with a single worker.
+     */
+    auto try_run_one() -> bool {
+        size_t self = worker_index();
+        Task task;
+        if (!find_task(self, task)) {
+            return false;
+        }
+        run(self, task);
+        return true;
+    }
+
+    /// Snapshot of every worker's counters.
+    [[nodiscard]] auto stats() const -> vector<WorkerStats> {
+        vector<WorkerStats> result;
+        result.reserve(m_workers.size());
+        for (const auto &worker : m_workers) {
+            result.push_back(
+                {worker->tasks_executed.load(std::memory_order_relaxed),
+                 worker->steals.load(std::memory_order_relaxed),
+                 std::chrono::nanoseconds(
+                     worker->idle_ns.load(std::memory_order_relaxed))});
+        }
+        return result;
+    }
+
+    /// Resets every worker's counters to zero.
+    void reset_stats() noexcept {
+        for (auto &worker : m_workers) {
+            worker->tasks_executed.store(0, std::memory_order_relaxed);
+            worker->steals.store(0, std::memory_order_relaxed);
+            worker->idle_ns.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+namespace detail {
+
+struct DefaultPoolState {
+    std::mutex mutex;
+    ThreadPoolConfig config;
+    std::unique_ptr<ThreadPool> pool;
+};
+
+inline DefaultPoolState &default_pool_state() {
+    static DefaultPoolState state;
+    return state;
+}
+
+} // namespace detail
+
+/**
+ * @brief Configures the process-wide pool used by the parallel algorithms
+ * @return An error if the configuration is invalid or the pool has already
+ * been started by an earlier call to default_pool()
+ */
+inline auto configure_default_pool(ThreadPoolConfig config)
+    -> std::expected<void, Error> {
+    if (config.num_threads > MAX_POOL_THREADS) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "a pool supports at most {} threads, but {} were requested",
+            MAX_POOL_THREADS, config.num_threads)));
+    }
+    auto &state = detail::default_pool_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.pool) {
+        return std::unexpected<Error>(Error::InvalidArgument(
+            "the default pool is already running"));
+    }
+    state.config = std::move(config);
+    return {};
+}
+
+/**
+ * @brief The process-wide pool, started on first use
+ */
+inline auto default_pool() -> ThreadPool & {
+    auto &state = detail::default_pool_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!state.pool) {
+        // The stored configuration has already been validated.
+        state.pool = std::move(ThreadPool::create(state.config).value());
+    }
+    return *state.pool;
+}
+
+/**
+ * @brief Fork/join scope over a ThreadPool
+ *
+ * `spawn` forks a task; `sync` joins all tasks spawned so far. While
+ * waiting, the calling thread runs queued tasks itself, so nested groups
+ * inside tasks are fine. The first exception thrown by a task is rethrown
+ * from `sync`.
+ */
+class TaskGroup {
+  private:
+    ThreadPool &m_pool;
+    std::atomic<size_t> m_pending{0};
+    std::mutex m_error_mutex;
+    std::exception_ptr m_error;
+
+    /// Counts `f` as pending and wraps it to record its exception.
+    template <typename F> auto wrap(F &&f) -> ThreadPool::Task {
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        return [this, f = std::forward<F>(f)]() mutable {
+            try {
+                f();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(m_error_mutex);
+                if (!m_error) {
+                    m_error = std::current_exception();
+                }
+            }
+            m_pending.fetch_sub(1, std::memory_order_release);
+        };
+    }
+
+    void join(bool help) {
+        while (m_pending.load(std::memory_order_acquire) > 0) {
+            if (!help || !m_pool.try_run_one()) {
+                std::this_thread::yield();
+            }
+        }
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(m_error_mutex);
+            std::swap(error, m_error);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+  public:
+    explicit TaskGroup(ThreadPool &pool = default_pool()) : m_pool(pool) {}
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    ~TaskGroup() {
+        try {
+            sync();
+        } catch (...) {
+            // Errors are only reported through an explicit sync().
+        }
+    }
+
+    template <typename F> void spawn(F &&f) {
+        m_pool.submit(wrap(std::forward<F>(f)));
+    }
+
+    /// Forks a task onto the deque of a given worker (see
+    /// ThreadPool::submit_to).
+    template <typename F> void spawn_on(size_t worker, F &&f) {
+        m_pool.submit_to(worker, wrap(std::forward<F>(f)));
+    }
+
+    void sync() { join(true); }
+
+    /**
+     * @brief Joins like `sync`, but a thread outside the pool only waits
+     *
+     * Tasks placed with `spawn_on` then run on the workers they were placed
+     * on rather than on the caller. Called from a worker, this is `sync`.
+     */
+    void sync_on_workers() { join(m_pool.is_worker()); }
+};
+
+/**
+ * @brief Calls `body(lo, hi)` on disjoint chunks covering [begin, end)
+ *
+ * The range is split in halves recursively until a chunk is at most `grain`
+ * long; halves are forked so idle workers steal the larger pieces first.
+ * A `grain` of 0 picks one that yields about four chunks per worker.
+ */
+template <typename F>
+void parallel_for(size_t begin, size_t end, size_t grain, F &&body,
+                  ThreadPool &pool = default_pool()) {
+    if (begin >= end) {
+        return;
+    }
+    if (grain == 0) {
+        grain = std::max<size_t>(1, (end - begin) / (4 * pool.num_workers()));
+    }
+    if (end - begin <= grain || pool.num_workers() == 1) {
+        body(begin, end);
+        return;
+    }
+    auto split = [&](auto &self, size_t lo, size_t hi, TaskGroup &group)
+        -> void {
+        while (hi - lo > grain) {
+            size_t mid = lo + (hi - lo) / 2;
+            group.spawn(
+                [&self, &group, mid, hi] { self(self, mid, hi, group); });
+            hi = mid;
+        }
+        body(lo, hi);
+    };
+    TaskGroup group(pool);
+    split(split, begin, end, group);
+    group.sync();
+}
+
+/**
+ * @brief Calls `body(lo, hi)` once per worker, on equal contiguous chunks
+ * of [begin, end) in order
+ *
+ * Chunk w is queued on worker w and the caller waits without stealing, so
+ * the same index range goes to the same worker on every call (best effort:
+ * a worker that finishes early may still steal an unstarted chunk). With a
+ * pinned pool this is what first-touch memory placement needs; `parallel_for`
+ * hands its chunks to whichever worker takes them first.
+ */
+template <typename F>
+void parallel_for_static(size_t begin, size_t end, F &&body,
+                         ThreadPool &pool = default_pool()) {
+    if (begin >= end) {
+        return;
+    }
+    size_t n = end - begin;
+    size_t chunks = std::min(pool.num_workers(), n);
+    if (chunks == 1) {
+        body(begin, end);
+        return;
+    }
+    TaskGroup group(pool);
+    for (size_t w = 0; w < chunks; w++) {
+        size_t lo = begin + n * w / chunks;
+        size_t hi = begin + n * (w + 1) / chunks;
+        group.spawn_on(w, [&body, lo, hi] { body(lo, hi); });
+    }
+    group.sync_on_workers();
+}
+
+#endif // PARALLEL_HPP
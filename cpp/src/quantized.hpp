@@ -0,0 +1,571 @@
+#ifndef QUANTIZED_HPP
+#define QUANTIZED_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+#include "error.hpp"
+#include "linalg.hpp"
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "tuning.hpp"
+
+using std::vector;
+
+/**
+ * @brief bfloat16: the upper half of an IEEE float
+ *
+ * Same exponent range as float with an 8-bit significand, so conversion
+ * from float is a rounding shift and never overflows.
+ */
+struct BFloat16 {
+    uint16_t bits = 0;
+
+    /// Rounds to nearest, ties to even; NaNs stay NaNs.
+    static BFloat16 from_float(float x) noexcept {
+        uint32_t u = std::bit_cast<uint32_t>(x);
+        if ((u & 0x7fffffffU) > 0x7f800000U) {
+            return {static_cast<uint16_t>((u >> 16) | 0x40U)};
+        }
+        u += 0x7fffU + ((u >> 16) & 1U);
+        return {static_cast<uint16_t>(u >> 16)};
+    }
+
+    [[nodiscard]] float to_float() const noexcept {
+        return std::bit_cast<float>(static_cast<uint32_t>(bits) << 16);
+    }
+};
+
+/**
+ * @brief IEEE 754 binary16
+ *
+ * Finite range is +-65504; larger floats convert to infinity.
+ */
+struct Float16 {
+    uint16_t bits = 0;
+
+    /// Rounds to nearest, ties to even.
+    static Float16 from_float(float x) noexcept {
+#if defined(__F16C__)
+        return {static_cast<uint16_t>(_cvtss_sh(x, _MM_FROUND_TO_NEAREST_INT))};
+#else
+        uint32_t u = std::bit_cast<uint32_t>(x);
+        auto sign = static_cast<uint16_t>((u >> 16) & 0x8000U);
+        uint32_t magnitude = u & 0x7fffffffU;
+        if (magnitude >= 0x7f800000U) {
+            bool nan = magnitude > 0x7f800000U;
+            return {static_cast<uint16_t>(sign | 0x7c00U | (nan ? 0x200U : 0))};
+        }
+        if (magnitude >= 0x477ff000U) { // rounds to 65536 or more
+            return {static_cast<uint16_t>(sign | 0x7c00U)};
+        }
+        if (magnitude < 0x38800000U) { // below 2^-14: subnormal or zero
+            float units = std::bit_cast<float>(magnitude) * 0x1p24f;
+            return {static_cast<uint16_t>(
+                sign | static_cast<uint16_t>(std::nearbyint(units)))};
+        }
+        magnitude += 0xfffU + ((magnitude >> 13) & 1U);
+        // Rebias the exponent from 127 to 15.
+        magnitude -= 0x38000000U;
+        return {static_cast<uint16_t>(sign | (magnitude >> 13))};
+#endif
+    }
+
+    [[nodiscard]] float to_float() const noexcept {
+#if defined(__F16C__)
+        return _cvtsh_ss(bits);
+#else
+        uint32_t sign = static_cast<uint32_t>(bits & 0x8000U) << 16;
+        uint32_t exponent = (bits >> 10) & 0x1fU;
+        uint32_t mantissa = bits & 0x3ffU;
+        if (exponent == 0) {
+            float value = static_cast<float>(mantissa) * 0x1p-24f;
+            return sign ? -value : value;
+        }
+        if (exponent == 31) {
+            return std::bit_cast<float>(sign | 0x7f800000U | (mantissa << 13));
+        }
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23) |
+                                    (mantissa << 13));
+#endif
+    }
+};
+
+template <typename Q>
+concept QuantizedInteger = std::same_as<Q, int8_t> || std::same_as<Q, int16_t>;
+
+template <typename H>
+concept HalfFloat = std::same_as<H, BFloat16> || std::same_as<H, Float16>;
+
+/**
+ * @brief Affine quantization: real value = scale * (q - zero_point)
+ */
+struct QuantParams {
+    float scale = 1.0f;
+    int32_t zero_point = 0;
+};
+
+/**
+ * @brief Row-major matrix of int8 or int16 values with one scale and zero
+ * point for the whole matrix
+ */
+template <QuantizedInteger Q> class QuantizedMatrix {
+  private:
+    vector<Q> m_data;
+    size_t m_rows;
+    size_t m_cols;
+    QuantParams m_params;
+
+  public:
+    static constexpr int32_t QMIN = std::numeric_limits<Q>::min();
+    static constexpr int32_t QMAX = std::numeric_limits<Q>::max();
+
+    QuantizedMatrix(size_t rows, size_t cols, QuantParams params)
+        : m_data(rows * cols, static_cast<Q>(params.zero_point)),
+          m_rows(rows), m_cols(cols), m_params(params) {}
+
+    /**
+     * @brief Parameters mapping [min(m), max(m)], widened to contain 0, onto
+     * the full range of Q, so that 0.0 is represented exactly
+     */
+    static auto choose_params(const Matrix<float> &m)
+        -> std::expected<QuantParams, Error> {
+        float lo = 0.0f;
+        float hi = 0.0f;
+        for (size_t i = 0; i < m.nrows() * m.ncols(); i++) {
+            float x = m.data()[i];
+            if (!std::isfinite(x)) {
+                return std::unexpected<Error>(Error::InvalidArgument(
+                    std::format("cannot quantize non-finite value {}", x)));
+            }
+            lo = std::min(lo, x);
+            hi = std::max(hi, x);
+        }
+        if (hi == lo) {
+            return QuantParams{1.0f, 0};
+        }
+        float scale = (hi - lo) / static_cast<float>(QMAX - QMIN);
+        auto zero_point = static_cast<int32_t>(
+            std::lround(static_cast<float>(QMIN) - lo / scale));
+        return QuantParams{scale, std::clamp(zero_point, QMIN, QMAX)};
+    }
+
+    /**
+     * @brief Quantizes `m` with the given parameters, saturating to Q
+     * @return An error if the scale is not positive and finite or the zero
+     * point does not fit Q
+     */
+    static auto quantize(const Matrix<float> &m, QuantParams params)
+        -> std::expected<QuantizedMatrix, Error> {
+        if (!(params.scale > 0.0f) || !std::isfinite(params.scale)) {
+            return std::unexpected<Error>(Error::InvalidArgument(
+                std::format("invalid quantization scale {}", params.scale)));
+        }
+        if (params.zero_point < QMIN || params.zero_point > QMAX) {
+            return std::unexpected<Error>(Error::InvalidArgument(
+                std::format("zero point {} outside [{}, {}]",
+                            params.zero_point, QMIN, QMAX)));
+        }
+        QuantizedMatrix q(m.nrows(), m.ncols(), params);
+        float inv_scale = 1.0f / params.scale;
+        for (size_t i = 0; i < q.m_data.size(); i++) {
+            float scaled = std::nearbyint(m.data()[i] * inv_scale) +
+                           static_cast<float>(params.zero_point);
+            scaled = std::clamp(scaled, static_cast<float>(QMIN),
+                                static_cast<float>(QMAX));
+            q.m_data[i] = static_cast<Q>(scaled);
+        }
+        return q;
+    }
+
+    /// Quantizes `m` with parameters from `choose_params`.
+    static auto quantize(const Matrix<float> &m)
+        -> std::expected<QuantizedMatrix, Error> {
+        auto params = choose_params(m);
+        if (!params) {
+            return std::unexpected<Error>(params.error());
+        }
+        return quantize(m, *params);
+    }
+
+    [[nodiscard]] size_t nrows() const noexcept { return m_rows; }
+    [[nodiscard]] size_t ncols() const noexcept { return m_cols; }
+    [[nodiscard]] QuantParams params() const noexcept { return m_params; }
+    [[nodiscard]] const Q *data() const noexcept { return m_data.data(); }
+    [[nodiscard]] Q *data() noexcept { return m_data.data(); }
+
+    [[nodiscard]] float dequantize(size_t row, size_t col) const noexcept {
+        return m_params.scale *
+               static_cast<float>(static_cast<int32_t>(
+                                      m_data[row * m_cols + col]) -
+                                  m_params.zero_point);
+    }
+
+    [[nodiscard]] Matrix<float> dequantize() const {
+        Matrix<float> m(m_rows, m_cols);
+        for (size_t i = 0; i < m_rows; i++) {
+            for (size_t j = 0; j < m_cols; j++) {
+                m.get_unchecked(i, j) = dequantize(i, j);
+            }
+        }
+        return m;
+    }
+};
+
+/**
+ * @brief Row-major matrix of bfloat16 or float16 values
+ */
+template <HalfFloat H> class HalfMatrix {
+  private:
+    vector<H> m_data;
+    size_t m_rows;
+    size_t m_cols;
+
+  public:
+    HalfMatrix(size_t rows, size_t cols)
+        : m_data(rows * cols), m_rows(rows), m_cols(cols) {}
+
+    /// Rounds every entry of `m` to H.
+    static HalfMatrix from_float(const Matrix<float> &m) {
+        HalfMatrix h(m.nrows(), m.ncols());
+        for (size_t i = 0; i < h.m_data.size(); i++) {
+            h.m_data[i] = H::from_float(m.data()[i]);
+        }
+        return h;
+    }
+
+    [[nodiscard]] size_t nrows() const noexcept { return m_rows; }
+    [[nodiscard]] size_t ncols() const noexcept { return m_cols; }
+    [[nodiscard]] const H *data() const noexcept { return m_data.data(); }
+    [[nodiscard]] H *data() noexcept { return m_data.data(); }
+
+    [[nodiscard]] Matrix<float> to_float() const {
+        Matrix<float> m(m_rows, m_cols);
+        for (size_t i = 0; i < m_data.size(); i++) {
+            m.data()[i] = m_data[i].to_float();
+        }
+        return m;
+    }
+};
+
+namespace detail {
+
+/// Depth to which packed operands are zero-padded, one 512-bit register of
+/// the narrowest element type.
+inline constexpr size_t QUANT_PACK_DEPTH = 64;
+
+/**
+ * Copies A (m x k) row-major and B (k x n) transposed into buffers whose
+ * rows are `depth` long, depth = k rounded up to QUANT_PACK_DEPTH, with zero
+ * padding. Every product entry is then a dot product of two contiguous,
+ * equally long rows, with no tail loop.
+ */
+template <typename T>
+void pack_operands(const T *a, const T *b, size_t m, size_t k, size_t n,
+                   size_t depth, vector<T> &pa, vector<T> &pbt) {
+    pa.assign(m * depth, T{});
+    pbt.assign(n * depth, T{});
+    for (size_t i = 0; i < m; i++) {
+        std::copy_n(a + i * k, k, pa.data() + i * depth);
+    }
+    for (size_t p = 0; p < k; p++) {
+        for (size_t j = 0; j < n; j++) {
+            pbt[j * depth + p] = b[p * n + j];
+        }
+    }
+}
+
+/// Vectors of 64 int8 pairs summed in int32 before widening to int64. A
+/// vector adds at most 64 * 255 * 128 over all lanes, so a block's total
+/// stays within int32.
+inline constexpr size_t DOT_I8_BLOCK = 1024;
+
+/**
+ * Sum of a[p] * b[p], `depth` a multiple of QUANT_PACK_DEPTH.
+ *
+ * With AVX-512 VNNI, vpdpbusd multiplies unsigned by signed bytes and adds
+ * groups of four into int32 lanes. Flipping the sign bit of `a` gives the
+ * unsigned value a + 128, so the result is biased by 128 * sum(b), which the
+ * caller removes with `b_sum`.
+ */
+inline auto dot_i8(const int8_t *a, const int8_t *b, size_t depth,
+                   int64_t b_sum) -> int64_t {
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+    const __m512i flip = _mm512_set1_epi8(static_cast<char>(0x80));
+    int64_t total = 0;
+    for (size_t p0 = 0; p0 < depth; p0 += DOT_I8_BLOCK * 64) {
+        size_t p1 = std::min(depth, p0 + DOT_I8_BLOCK * 64);
+        __m512i acc = _mm512_setzero_si512();
+        for (size_t p = p0; p < p1; p += 64) {
+            __m512i va = _mm512_xor_si512(_mm512_loadu_si512(a + p), flip);
+            __m512i vb = _mm512_loadu_si512(b + p);
+            acc = _mm512_dpbusd_epi32(acc, va, vb);
+        }
+        total += _mm512_reduce_add_epi32(acc);
+    }
+    return total - 128 * b_sum;
+#else
+    (void)b_sum;
+    int64_t total = 0;
+    for (size_t p0 = 0; p0 < depth; p0 += DOT_I8_BLOCK * 64) {
+        size_t p1 = std::min(depth, p0 + DOT_I8_BLOCK * 64);
+        int32_t acc = 0;
+        for (size_t p = p0; p < p1; p++) {
+            acc += static_cast<int32_t>(a[p]) * static_cast<int32_t>(b[p]);
+        }
+        total += acc;
+    }
+    return total;
+#endif
+}
+
+/// Sum of a[p] * b[p] for int16. Two full-range int16 products already
+/// overflow int32, so products are widened to int64 before summing.
+inline auto dot_i16(const int16_t *a, const int16_t *b, size_t depth,
+                    int64_t) -> int64_t {
+    int64_t total = 0;
+    for (size_t p = 0; p < depth; p++) {
+        total += static_cast<int64_t>(static_cast<int32_t>(a[p]) * b[p]);
+    }
+    return total;
+}
+
+/**
+ * Sum of a[p] * b[p] in fp32, `depth` a multiple of QUANT_PACK_DEPTH. With
+ * AVX-512 BF16, vdpbf16ps multiplies pairs of bf16 and accumulates in fp32;
+ * without it, bf16 is widened to fp32 by a 16-bit shift.
+ */
+inline auto dot_bf16(const BFloat16 *a, const BFloat16 *b, size_t depth)
+    -> float {
+#if defined(__AVX512BF16__)
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t p = 0; p < depth; p += 32) {
+        __m512i va = _mm512_loadu_si512(a + p);
+        __m512i vb = _mm512_loadu_si512(b + p);
+        acc = _mm512_dpbf16_ps(acc, (__m512bh)va, (__m512bh)vb);
+    }
+    return _mm512_reduce_add_ps(acc);
+#elif defined(__AVX512F__)
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t p = 0; p < depth; p += 16) {
+        __m512i wa = _mm512_cvtepu16_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + p)));
+        __m512i wb = _mm512_cvtepu16_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + p)));
+        acc = _mm512_fmadd_ps(
+            _mm512_castsi512_ps(_mm512_slli_epi32(wa, 16)),
+            _mm512_castsi512_ps(_mm512_slli_epi32(wb, 16)), acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+#else
+    float acc = 0.0f;
+    for (size_t p = 0; p < depth; p++) {
+        acc += a[p].to_float() * b[p].to_float();
+    }
+    return acc;
+#endif
+}
+
+/// Sum of a[p] * b[p] in fp32 for float16, converting 16 values at a time
+/// with vcvtph2ps when AVX-512 is available.
+inline auto dot_f16(const Float16 *a, const Float16 *b, size_t depth)
+    -> float {
+#if defined(__AVX512F__)
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t p = 0; p < depth; p += 16) {
+        __m512 va = _mm512_cvtph_ps(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + p)));
+        __m512 vb = _mm512_cvtph_ps(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + p)));
+        acc = _mm512_fmadd_ps(va, vb, acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+#else
+    float acc = 0.0f;
+    for (size_t p = 0; p < depth; p++) {
+        acc += a[p].to_float() * b[p].to_float();
+    }
+    return acc;
+#endif
+}
+
+inline auto shape_error(size_t m, size_t k, size_t rows, size_t n) -> Error {
+    return Error::InvalidArgument(
+        std::format("cannot multiply {}x{} by {}x{}", m, k, rows, n));
+}
+
+/**
+ * Runs `entry(i, j)` for every entry of an m x n product in parallel over
+ * the row blocks of `parallel_rows`, and within a block column block by
+ * column block so the packed columns in use stay in cache.
+ */
+template <typename F> void for_each_entry(size_t m, size_t n, F &&entry) {
+    size_t block_cols = tuning().quant_block_cols;
+    auto body = [&](size_t lo, size_t hi) {
+        for (size_t j0 = 0; j0 < n; j0 += block_cols) {
+            size_t j1 = std::min(n, j0 + block_cols);
+            for (size_t i = lo; i < hi; i++) {
+                for (size_t j = j0; j < j1; j++) {
+                    entry(i, j);
+                }
+            }
+        }
+    };
+    if (m <= tuning().gemm_row_grain) {
+        body(0, m);
+    } else {
+        parallel_rows(m, [&](size_t, size_t lo, size_t hi) { body(lo, hi); });
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Product of two quantized matrices, dequantized to float
+ *
+ * Integer dot products are computed on the raw values and the zero points
+ * are folded in afterwards:
+ *   sum (a - za)(b - zb) = sum ab - zb sum a - za sum b + k za zb,
+ * so the inner loop is a pure int8 (or int16) dot product: vpdpbusd with
+ * AVX-512 VNNI, a portable loop otherwise.
+ *
+ * @return An error if the inner dimensions differ
+ */
+template <QuantizedInteger Q>
+auto quantized_matmul(const QuantizedMatrix<Q> &a, const QuantizedMatrix<Q> &b)
+    -> std::expected<Matrix<float>, Error> {
+    size_t m = a.nrows();
+    size_t k = a.ncols();
+    size_t n = b.ncols();
+    if (b.nrows() != k) {
+        return std::unexpected<Error>(detail::shape_error(m, k, b.nrows(), n));
+    }
+    size_t depth = (k + detail::QUANT_PACK_DEPTH - 1) /
+                   detail::QUANT_PACK_DEPTH * detail::QUANT_PACK_DEPTH;
+    vector<Q> pa;
+    vector<Q> pbt;
+    detail::pack_operands(a.data(), b.data(), m, k, n, depth, pa, pbt);
+
+    vector<int64_t> row_sums(m, 0);
+    vector<int64_t> col_sums(n, 0);
+    for (size_t i = 0; i < m; i++) {
+        for (size_t p = 0; p < k; p++) {
+            row_sums[i] += pa[i * depth + p];
+        }
+    }
+    for (size_t j = 0; j < n; j++) {
+        for (size_t p = 0; p < k; p++) {
+            col_sums[j] += pbt[j * depth + p];
+        }
+    }
+
+    int64_t za = a.params().zero_point;
+    int64_t zb = b.params().zero_point;
+    float scale = a.params().scale * b.params().scale;
+    int64_t offset = static_cast<int64_t>(k) * za * zb;
+    Matrix<float> c(m, n);
+    detail::for_each_entry(m, n, [&](size_t i, size_t j) {
+        const Q *arow = pa.data() + i * depth;
+        const Q *bcol = pbt.data() + j * depth;
+        int64_t dot;
+        if constexpr (std::same_as<Q, int8_t>) {
+            dot = detail::dot_i8(arow, bcol, depth, col_sums[j]);
+        } else {
+            dot = detail::dot_i16(arow, bcol, depth, col_sums[j]);
+        }
+        int64_t acc = dot - zb * row_sums[i] - za * col_sums[j] + offset;
+        c.get_unchecked(i, j) = scale * static_cast<float>(acc);
+    });
+    return c;
+}
+
+/**
+ * @brief Product of two bfloat16 or float16 matrices with fp32 accumulation
+ *
+ * @return An error if the inner dimensions differ
+ */
+template <HalfFloat H>
+auto half_matmul(const HalfMatrix<H> &a, const HalfMatrix<H> &b)
+    -> std::expected<Matrix<float>, Error> {
+    size_t m = a.nrows();
+    size_t k = a.ncols();
+    size_t n = b.ncols();
+    if (b.nrows() != k) {
+        return std::unexpected<Error>(detail::shape_error(m, k, b.nrows(), n));
+    }
+    size_t depth = (k + detail::QUANT_PACK_DEPTH - 1) /
+                   detail::QUANT_PACK_DEPTH * detail::QUANT_PACK_DEPTH;
+    vector<H> pa;
+    vector<H> pbt;
+    detail::pack_operands(a.data(), b.data(), m, k, n, depth, pa, pbt);
+
+    Matrix<float> c(m, n);
+    detail::for_each_entry(m, n, [&](size_t i, size_t j) {
+        const H *arow = pa.data() + i * depth;
+        const H *bcol = pbt.data() + j * depth;
+        if constexpr (std::same_as<H, BFloat16>) {
+            c.get_unchecked(i, j) = detail::dot_bf16(arow, bcol, depth);
+        } else {
+            c.get_unchecked(i, j) = detail::dot_f16(arow, bcol, depth);
+        }
+    });
+    return c;
+}
+
+/**
+ * @brief Error of a low-precision result against a double-precision
+ * reference
+ */
+struct AccuracyReport {
+    double max_abs_error = 0.0;
+    double rms_error = 0.0;
+    /// Frobenius norm of the error divided by that of the reference.
+    double relative_error = 0.0;
+};
+
+/**
+ * @brief Compares `approx` entry by entry with `reference`
+ * @return An error if the shapes differ
+ */
+inline auto measure_accuracy(const Matrix<double> &reference,
+                             const Matrix<float> &approx)
+    -> std::expected<AccuracyReport, Error> {
+    if (reference.nrows() != approx.nrows() ||
+        reference.ncols() != approx.ncols()) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "reference is {}x{} but the result is {}x{}", reference.nrows(),
+            reference.ncols(), approx.nrows(), approx.ncols())));
+    }
+    size_t count = reference.nrows() * reference.ncols();
+    AccuracyReport report;
+    double error_sq = 0.0;
+    double reference_sq = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double r = reference.data()[i];
+        double e = static_cast<double>(approx.data()[i]) - r;
+        report.max_abs_error = std::max(report.max_abs_error, std::abs(e));
+        error_sq += e * e;
+        reference_sq += r * r;
+    }
+    if (count > 0) {
+        report.rms_error = std::sqrt(error_sq / static_cast<double>(count));
+    }
+    report.relative_error =
+        reference_sq > 0.0 ? std::sqrt(error_sq / reference_sq)
+                           : std::sqrt(error_sq);
+    return report;
+}
+
+#endif // QUANTIZED_HPP
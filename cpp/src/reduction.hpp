@@ -0,0 +1,334 @@
+#ifndef REDUCTION_HPP
+#define REDUCTION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <expected>
+#include <format>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "error.hpp"
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "tuning.hpp"
+
+using std::vector;
+
+/// Rows combined per pass of a column reduction.
+inline constexpr size_t REDUCE_COL_ROWS = 4;
+
+namespace detail {
+
+/// Independent accumulators per contiguous reduction. Each lane is updated
+/// with the same operation, which compilers turn into one vector register.
+inline constexpr size_t REDUCE_LANES = 16;
+
+template <typename T> struct SumOp {
+    static constexpr T identity() { return T{}; }
+    static T map(T x) { return x; }
+    static T combine(T a, T b) { return a + b; }
+};
+
+template <typename T> struct SquareSumOp {
+    static constexpr T identity() { return T{}; }
+    static T map(T x) { return x * x; }
+    static T combine(T a, T b) { return a + b; }
+};
+
+template <typename T> struct MinOp {
+    static constexpr T identity() {
+        if constexpr (std::numeric_limits<T>::has_infinity) {
+            return std::numeric_limits<T>::infinity();
+        } else {
+            return std::numeric_limits<T>::max();
+        }
+    }
+    static T map(T x) { return x; }
+    static T combine(T a, T b) { return b < a ? b : a; }
+};
+
+template <typename T> struct MaxOp {
+    static constexpr T identity() {
+        if constexpr (std::numeric_limits<T>::has_infinity) {
+            return -std::numeric_limits<T>::infinity();
+        } else {
+            return std::numeric_limits<T>::lowest();
+        }
+    }
+    static T map(T x) { return x; }
+    static T combine(T a, T b) { return a < b ? b : a; }
+};
+
+/// Reduces `n` contiguous elements with REDUCE_LANES interleaved
+/// accumulators, breaking the dependency chain of a single accumulator.
+template <typename Op, typename T>
+auto reduce_contiguous(const T *x, size_t n) -> T {
+    T acc[REDUCE_LANES];
+    std::fill_n(acc, REDUCE_LANES, Op::identity());
+    size_t i = 0;
+    for (; i + REDUCE_LANES <= n; i += REDUCE_LANES) {
+        for (size_t l = 0; l < REDUCE_LANES; l++) {
+            acc[l] = Op::combine(acc[l], Op::map(x[i + l]));
+        }
+    }
+    T total = Op::identity();
+    for (size_t l = 0; l < REDUCE_LANES; l++) {
+        total = Op::combine(total, acc[l]);
+    }
+    for (; i < n; i++) {
+        total = Op::combine(total, Op::map(x[i]));
+    }
+    return total;
+}
+
+/// Sum of x[i] * y[i], with the same lane structure as `reduce_contiguous`.
+template <typename T> auto dot(const T *x, const T *y, size_t n) -> T {
+    T acc[REDUCE_LANES] = {};
+    size_t i = 0;
+    for (; i + REDUCE_LANES <= n; i += REDUCE_LANES) {
+        for (size_t l = 0; l < REDUCE_LANES; l++) {
+            acc[l] += x[i + l] * y[i + l];
+        }
+    }
+    T total{};
+    for (size_t l = 0; l < REDUCE_LANES; l++) {
+        total += acc[l];
+    }
+    for (; i < n; i++) {
+        total += x[i] * y[i];
+    }
+    return total;
+}
+
+/**
+ * Whether a reduction over `rows` rows of `cols` elements is split over the
+ * default pool: it must have at least `tuning().reduce_parallel_min`
+ * elements and more than one row.
+ */
+inline auto reduce_in_parallel(size_t rows, size_t cols) -> bool {
+    return rows > 1 &&
+           rows * std::max<size_t>(cols, 1) >= tuning().reduce_parallel_min;
+}
+
+template <typename Op, typename T>
+auto reduce_rows(const MatrixView<T> &m) -> vector<T> {
+    size_t rows = m.nrows();
+    size_t cols = m.ncols();
+    vector<T> out(rows);
+    auto body = [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++) {
+            out[i] = reduce_contiguous<Op>(m.data() + i * m.stride(), cols);
+        }
+    };
+    if (reduce_in_parallel(rows, cols)) {
+        parallel_rows(rows,
+                      [&](size_t, size_t lo, size_t hi) { body(lo, hi); });
+    } else {
+        body(0, rows);
+    }
+    return out;
+}
+
+/**
+ * Accumulates rows [lo, hi) into `acc` (length cols). Rows are taken
+ * REDUCE_COL_ROWS at a time and combined element-wise first, so `acc` is
+ * read and written once per group of rows and every access is contiguous.
+ */
+template <typename Op, typename T>
+void reduce_cols_range(const MatrixView<T> &m, size_t lo, size_t hi, T *acc) {
+    size_t cols = m.ncols();
+    size_t stride = m.stride();
+    size_t i = lo;
+    for (; i + REDUCE_COL_ROWS <= hi; i += REDUCE_COL_ROWS) {
+        const T *r0 = m.data() + i * stride;
+        const T *r1 = r0 + stride;
+        const T *r2 = r1 + stride;
+        const T *r3 = r2 + stride;
+        for (size_t j = 0; j < cols; j++) {
+            T a = Op::combine(Op::map(r0[j]), Op::map(r1[j]));
+            T b = Op::combine(Op::map(r2[j]), Op::map(r3[j]));
+            acc[j] = Op::combine(acc[j], Op::combine(a, b));
+        }
+    }
+    for (; i < hi; i++) {
+        const T *row = m.data() + i * stride;
+        for (size_t j = 0; j < cols; j++) {
+            acc[j] = Op::combine(acc[j], Op::map(row[j]));
+        }
+    }
+}
+
+/// Column reduction; large matrices are split into the row blocks of
+/// `parallel_rows`, reduced into private accumulators in parallel and then
+/// combined.
+template <typename Op, typename T>
+auto reduce_cols(const MatrixView<T> &m) -> vector<T> {
+    size_t rows = m.nrows();
+    size_t cols = m.ncols();
+    vector<T> out(cols, Op::identity());
+    if (!reduce_in_parallel(rows, cols)) {
+        reduce_cols_range<Op>(m, 0, rows, out.data());
+        return out;
+    }
+    vector<vector<T>> partial(row_blocks(rows),
+                              vector<T>(cols, Op::identity()));
+    parallel_rows(rows, [&](size_t block, size_t lo, size_t hi) {
+        reduce_cols_range<Op>(m, lo, hi, partial[block].data());
+    });
+    for (const auto &p : partial) {
+        for (size_t j = 0; j < cols; j++) {
+            out[j] = Op::combine(out[j], p[j]);
+        }
+    }
+    return out;
+}
+
+template <typename T>
+auto empty_axis_error(const MatrixView<T> &m) -> Error {
+    return Error::InvalidArgument(std::format(
+        "min/max over an empty axis of a {}x{} matrix", m.nrows(), m.ncols()));
+}
+
+} // namespace detail
+
+/// Sum of every row.
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto row_sums(const MatrixView<T> &m) -> vector<T> {
+    return detail::reduce_rows<detail::SumOp<T>>(m);
+}
+
+/// Sum of every column.
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto col_sums(const MatrixView<T> &m) -> vector<T> {
+    return detail::reduce_cols<detail::SumOp<T>>(m);
+}
+
+/// Euclidean norm of every row.
+template <std::floating_point T>
+auto row_norms(const MatrixView<T> &m) -> vector<T> {
+    vector<T> out = detail::reduce_rows<detail::SquareSumOp<T>>(m);
+    for (T &x : out) {
+        x = std::sqrt(x);
+    }
+    return out;
+}
+
+/// Euclidean norm of every column.
+template <std::floating_point T>
+auto col_norms(const MatrixView<T> &m) -> vector<T> {
+    vector<T> out = detail::reduce_cols<detail::SquareSumOp<T>>(m);
+    for (T &x : out) {
+        x = std::sqrt(x);
+    }
+    return out;
+}
+
+/**
+ * @brief Minimum of every row
+ * @return An error if the rows are empty
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto row_min(const MatrixView<T> &m) -> std::expected<vector<T>, Error> {
+    if (m.ncols() == 0 && m.nrows() > 0) {
+        return std::unexpected<Error>(detail::empty_axis_error(m));
+    }
+    return detail::reduce_rows<detail::MinOp<T>>(m);
+}
+
+/**
+ * @brief Maximum of every row
+ * @return An error if the rows are empty
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto row_max(const MatrixView<T> &m) -> std::expected<vector<T>, Error> {
+    if (m.ncols() == 0 && m.nrows() > 0) {
+        return std::unexpected<Error>(detail::empty_axis_error(m));
+    }
+    return detail::reduce_rows<detail::MaxOp<T>>(m);
+}
+
+/**
+ * @brief Minimum of every column
+ * @return An error if the columns are empty
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto col_min(const MatrixView<T> &m) -> std::expected<vector<T>, Error> {
+    if (m.nrows() == 0 && m.ncols() > 0) {
+        return std::unexpected<Error>(detail::empty_axis_error(m));
+    }
+    return detail::reduce_cols<detail::MinOp<T>>(m);
+}
+
+/**
+ * @brief Maximum of every column
+ * @return An error if the columns are empty
+ */
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto col_max(const MatrixView<T> &m) -> std::expected<vector<T>, Error> {
+    if (m.nrows() == 0 && m.ncols() > 0) {
+        return std::unexpected<Error>(detail::empty_axis_error(m));
+    }
+    return detail::reduce_cols<detail::MaxOp<T>>(m);
+}
+
+/// A view of the whole of `m`; the overloads below reduce whole matrices.
+template <typename T> auto full_view(const Matrix<T> &m) -> MatrixView<T> {
+    return m.view(0, 0, m.nrows(), m.ncols());
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto row_sums(const Matrix<T> &m) -> vector<T> {
+    return row_sums(full_view(m));
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto col_sums(const Matrix<T> &m) -> vector<T> {
+    return col_sums(full_view(m));
+}
+
+template <std::floating_point T>
+auto row_norms(const Matrix<T> &m) -> vector<T> {
+    return row_norms(full_view(m));
+}
+
+template <std::floating_point T>
+auto col_norms(const Matrix<T> &m) -> vector<T> {
+    return col_norms(full_view(m));
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto row_min(const Matrix<T> &m) -> std::expected<vector<T>, Error> {
+    return row_min(full_view(m));
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto row_max(const Matrix<T> &m) -> std::expected<vector<T>, Error> {
+    return row_max(full_view(m));
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto col_min(const Matrix<T> &m) -> std::expected<vector<T>, Error> {
+    return col_min(full_view(m));
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T>
+auto col_max(const Matrix<T> &m) -> std::expected<vector<T>, Error> {
+    return col_max(full_view(m));
+}
+
+#endif // REDUCTION_HPP
@@ -0,0 +1,343 @@
+#ifndef SCAN_HPP
+#define SCAN_HPP
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "error.hpp"
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "tuning.hpp"
+
+using std::vector;
+
+/**
+ * @brief An associative binary operator on T
+ *
+ * Scans regroup operations freely (in blocks and across threads), so the
+ * operator must be associative; it need not be commutative.
+ */
+template <typename Op, typename T>
+concept ScanOperator =
+    std::regular_invocable<Op &, const T &, const T &> &&
+    std::convertible_to<std::invoke_result_t<Op &, const T &, const T &>, T>;
+
+namespace detail {
+
+/// Serial inclusive scan of `data[0:n)` in place.
+template <typename T, ScanOperator<T> Op>
+void scan_serial(T *data, size_t n, Op &op) {
+    for (size_t i = 1; i < n; i++) {
+        data[i] = op(data[i - 1], data[i]);
+    }
+}
+
+#if defined(__AVX2__)
+/**
+ * In-register inclusive prefix sum of eight int32 lanes: two shifted adds
+ * within each 128-bit half, then the low half's total is added to the upper
+ * half.
+ */
+inline auto prefix_sum_epi32(__m256i x) -> __m256i {
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    __m256i low_total = _mm256_shuffle_epi32(x, 0xFF);
+    low_total = _mm256_permute2x128_si256(low_total, low_total, 0x08);
+    return _mm256_add_epi32(x, low_total);
+}
+
+inline auto prefix_sum_ps(__m256 x) -> __m256 {
+    x = _mm256_add_ps(
+        x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 4)));
+    x = _mm256_add_ps(
+        x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 8)));
+    __m256 low_total = _mm256_shuffle_ps(x, x, 0xFF);
+    low_total = _mm256_permute2f128_ps(low_total, low_total, 0x08);
+    return _mm256_add_ps(x, low_total);
+}
+#endif
+
+/**
+ * Inclusive scan of `data[0:n)` in place, with `carry` combined into the
+ * first element (`carry` must be the identity when there is none).
+ *
+ * Sums of int32 and float take an AVX2 path when available: each group of
+ * eight is scanned in registers and the running total is broadcast from the
+ * last lane. Float results may differ from the serial order in the last
+ * bits, as with any reassociated floating-point sum.
+ */
+template <typename T, ScanOperator<T> Op>
+void scan_block(T *data, size_t n, Op &op, T carry) {
+    if (n == 0) {
+        return;
+    }
+#if defined(__AVX2__)
+    size_t i = 0;
+    if constexpr (std::is_same_v<Op, std::plus<T>> ||
+                  std::is_same_v<Op, std::plus<>>) {
+        if constexpr (std::is_same_v<T, int32_t>) {
+            __m256i running = _mm256_set1_epi32(carry);
+            for (; i + 8 <= n; i += 8) {
+                auto *p = reinterpret_cast<__m256i *>(data + i);
+                __m256i x = _mm256_add_epi32(
+                    prefix_sum_epi32(_mm256_loadu_si256(p)), running);
+                _mm256_storeu_si256(p, x);
+                running = _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32(7));
+            }
+            carry = _mm256_cvtsi256_si32(running);
+            if (i == n) {
+                return;
+            }
+            data[i] = op(carry, data[i]);
+            scan_serial(data + i, n - i, op);
+            return;
+        } else if constexpr (std::is_same_v<T, float>) {
+            __m256 running = _mm256_set1_ps(carry);
+            for (; i + 8 <= n; i += 8) {
+                __m256 x = _mm256_add_ps(
+                    prefix_sum_ps(_mm256_loadu_ps(data + i)), running);
+                _mm256_storeu_ps(data + i, x);
+                running = _mm256_permutevar8x32_ps(x, _mm256_set1_epi32(7));
+            }
+            carry = _mm256_cvtss_f32(running);
+            if (i == n) {
+                return;
+            }
+            data[i] = op(carry, data[i]);
+            scan_serial(data + i, n - i, op);
+            return;
+        }
+    }
+#endif
+    data[0] = op(carry, data[0]);
+    scan_serial(data, n, op);
+}
+
+/// Combination of all of `data[0:n)`, n > 0.
+template <typename T, ScanOperator<T> Op>
+auto reduce_block(const T *data, size_t n, Op &op) -> T {
+    T acc = data[0];
+    for (size_t i = 1; i < n; i++) {
+        acc = op(acc, data[i]);
+    }
+    return acc;
+}
+
+} // namespace detail
+
+/**
+ * @brief Inclusive scan in place: `data[i] = data[0] op ... op data[i]`
+ *
+ * `identity` must satisfy `op(identity, x) == x`. Large inputs use a
+ * two-pass block scan on the default pool: every worker reduces one
+ * contiguous block, the block totals are scanned serially, and every worker
+ * then scans its block seeded with the total of the blocks before it.
+ */
+template <typename T, ScanOperator<T> Op = std::plus<T>>
+void inclusive_scan(vector<T> &data, Op op = {}, T identity = T{}) {
+    size_t n = data.size();
+    ThreadPool &pool = default_pool();
+    size_t blocks = pool.num_workers();
+    if (n < tuning().scan_parallel_cutoff || blocks == 1) {
+        detail::scan_block(data.data(), n, op, identity);
+        return;
+    }
+    size_t block_size = (n + blocks - 1) / blocks;
+    vector<T> totals(blocks, identity);
+    parallel_for(0, blocks, 1, [&](size_t lo, size_t hi) {
+        for (size_t b = lo; b < hi; b++) {
+            size_t begin = std::min(b * block_size, n);
+            size_t end = std::min(begin + block_size, n);
+            if (begin < end) {
+                totals[b] = detail::reduce_block(data.data() + begin,
+                                                 end - begin, op);
+            }
+        }
+    });
+    // Exclusive scan of the block totals: the carry into every block.
+    T running = identity;
+    for (size_t b = 0; b < blocks; b++) {
+        T total = totals[b];
+        totals[b] = running;
+        running = op(running, total);
+    }
+    parallel_for(0, blocks, 1, [&](size_t lo, size_t hi) {
+        for (size_t b = lo; b < hi; b++) {
+            size_t begin = std::min(b * block_size, n);
+            size_t end = std::min(begin + block_size, n);
+            detail::scan_block(data.data() + begin, end - begin, op,
+                               totals[b]);
+        }
+    });
+}
+
+/**
+ * @brief Exclusive scan in place: `data[i] = identity op data[0] op ... op
+ * data[i - 1]`
+ * @return The combination of every element, i.e. what `data[n]` would be
+ */
+template <typename T, ScanOperator<T> Op = std::plus<T>>
+auto exclusive_scan(vector<T> &data, Op op = {}, T identity = T{}) -> T {
+    if (data.empty()) {
+        return identity;
+    }
+    inclusive_scan(data, op, identity);
+    T total = data.back();
+    std::move_backward(data.begin(), data.end() - 1, data.end());
+    data[0] = identity;
+    return total;
+}
+
+namespace detail {
+
+/// A value tagged with whether it starts a new segment.
+template <typename T> struct Segmented {
+    bool head;
+    T value;
+};
+
+/// Lifts `op` to (head, value) pairs; associative whenever `op` is.
+template <typename T, typename Op> struct SegmentedOp {
+    Op op;
+
+    auto operator()(const Segmented<T> &a, const Segmented<T> &b)
+        -> Segmented<T> {
+        return {a.head || b.head, b.head ? b.value : op(a.value, b.value)};
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Segmented inclusive scan in place
+ *
+ * `heads[i]` set to true starts a new segment at i, where the running value
+ * restarts from `data[i]`. Large inputs are scanned as (head, value) pairs
+ * with the lifted segmented operator, which reuses the parallel block scan.
+ */
+template <typename T, ScanOperator<T> Op = std::plus<T>>
+auto segmented_scan(vector<T> &data, const vector<bool> &heads, Op op = {},
+                    T identity = T{}) -> std::expected<void, Error> {
+    if (heads.size() != data.size()) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "{} segment flags for {} values", heads.size(), data.size())));
+    }
+    if (data.size() < tuning().scan_parallel_cutoff) {
+        for (size_t i = 1; i < data.size(); i++) {
+            if (!heads[i]) {
+                data[i] = op(data[i - 1], data[i]);
+            }
+        }
+        return {};
+    }
+    vector<detail::Segmented<T>> pairs(data.size());
+    for (size_t i = 0; i < data.size(); i++) {
+        pairs[i] = {heads[i], std::move(data[i])};
+    }
+    inclusive_scan(pairs, detail::SegmentedOp<T, Op>{op},
+                   detail::Segmented<T>{false, identity});
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = std::move(pairs[i].value);
+    }
+    return {};
+}
+
+/**
+ * @brief Inclusive scan by key: runs of equal consecutive keys form the
+ * segments of a `segmented_scan` over `values`
+ */
+template <typename K, typename T, ScanOperator<T> Op = std::plus<T>>
+    requires std::equality_comparable<K>
+auto scan_by_key(const vector<K> &keys, vector<T> &values, Op op = {},
+                 T identity = T{}) -> std::expected<void, Error> {
+    if (keys.size() != values.size()) {
+        return std::unexpected<Error>(Error::InvalidArgument(std::format(
+            "{} keys for {} values", keys.size(), values.size())));
+    }
+    vector<bool> heads(keys.size(), true);
+    for (size_t i = 1; i < keys.size(); i++) {
+        heads[i] = !(keys[i] == keys[i - 1]);
+    }
+    return segmented_scan(values, heads, std::move(op), std::move(identity));
+}
+
+/**
+ * @brief Inclusive scan along every row of `matrix`, in place
+ *
+ * Rows are contiguous, so each row takes the in-register block scan; large
+ * matrices are split over the default pool with `parallel_rows`.
+ */
+template <typename T, ScanOperator<T> Op = std::plus<T>>
+void scan_rows(Matrix<T> &matrix, Op op = {}, T identity = T{}) {
+    size_t rows = matrix.nrows();
+    size_t cols = matrix.ncols();
+    T *data = matrix.data();
+    auto body = [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++) {
+            detail::scan_block(data + i * cols, cols, op, identity);
+        }
+    };
+    if (rows < 2 || rows * cols < tuning().scan_parallel_cutoff) {
+        body(0, rows);
+    } else {
+        parallel_rows(rows,
+                      [&](size_t, size_t lo, size_t hi) { body(lo, hi); });
+    }
+}
+
+/**
+ * @brief Inclusive scan down every column of `matrix`, in place
+ *
+ * Walks the matrix row by row, combining each row with the one above it, so
+ * memory is read contiguously and the inner loop vectorizes. Large matrices
+ * take two passes over the row blocks of `parallel_rows`: every worker scans
+ * its block, the last rows of the blocks are combined serially, and every
+ * worker then combines its block with the last row of the block above.
+ */
+template <typename T, ScanOperator<T> Op = std::plus<T>>
+void scan_cols(Matrix<T> &matrix, Op op = {}) {
+    size_t rows = matrix.nrows();
+    size_t cols = matrix.ncols();
+    T *data = matrix.data();
+    auto combine_row = [&](const T *above, T *row) {
+        for (size_t j = 0; j < cols; j++) {
+            row[j] = op(above[j], row[j]);
+        }
+    };
+    auto scan_range = [&](size_t lo, size_t hi) {
+        for (size_t i = lo + 1; i < hi; i++) {
+            combine_row(data + (i - 1) * cols, data + i * cols);
+        }
+    };
+    if (rows < 2 || rows * cols < tuning().scan_parallel_cutoff) {
+        scan_range(0, rows);
+        return;
+    }
+    size_t blocks = row_blocks(rows);
+    parallel_rows(rows,
+                  [&](size_t, size_t lo, size_t hi) { scan_range(lo, hi); });
+    for (size_t b = 1; b < blocks; b++) {
+        combine_row(data + (rows * b / blocks - 1) * cols,
+                    data + (rows * (b + 1) / blocks - 1) * cols);
+    }
+    // The last row of every block is final now; the other rows of block b
+    // take the last row of block b - 1, which no worker writes.
+    parallel_rows(rows, [&](size_t block, size_t lo, size_t hi) {
+        for (size_t i = lo; block > 0 && i + 1 < hi; i++) {
+            combine_row(data + (lo - 1) * cols, data + i * cols);
+        }
+    });
+}
+
+#endif // SCAN_HPP
@@ -0,0 +1,307 @@
+#ifndef TUNING_HPP
+#define TUNING_HPP
+
+#include <array>
+#include <charconv>
+#include <cstdlib>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include "error.hpp"
+
+/// Environment variable naming the tuning profile to load. Without it the
+/// profile is read from `$HOME/.config/clrs/tuning.conf`.
+inline constexpr const char *TUNING_PROFILE_ENV = "CLRS_TUNING_PROFILE";
+
+/**
+ * @brief Crossover points and block sizes that depend on the machine
+ *
+ * The defaults are the values the kernels were written with. `autotune`
+ * measures better ones for the current machine, and a profile saved with
+ * `save_tuning_profile` is picked up by `tuning()` on the next start.
+ */
+struct TuningProfile {
+    /// Ranges of `merge_sort` this short are finished by insertion sort.
+    size_t merge_sort_cutoff = 16;
+
+    /// Depth of the k-blocks in `gemm`, chosen so that a block of B stays in
+    /// L2.
+    size_t gemm_block_k = 256;
+
+    /// Products with at most this many rows of C stay on one thread in
+    /// `gemm`, `matrix_power_mod` and the quantized kernels.
+    size_t gemm_row_grain = 32;
+
+    /// Width of the column panels factored by `lu_factor`.
+    size_t lu_block = 64;
+
+    /// Rows below which a panel step of `lu_factor` stays on one thread.
+    size_t lu_parallel_rows = 512;
+
+    /// Entries of A below which `gemv` and `gemv_transposed` use one thread.
+    size_t gemv_parallel_min = 1 << 17;
+
+    /// Elements below which a reduction stays on the calling thread.
+    size_t reduce_parallel_min = 1 << 17;
+
+    /// Inputs shorter than this are scanned on the calling thread only; also
+    /// the work per task of `scan_rows` and `scan_cols`.
+    size_t scan_parallel_cutoff = 1 << 18;
+
+    /// Ranges shorter than this are never split across threads by
+    /// `parallel_count_inversions`.
+    size_t inversions_parallel_cutoff = 1 << 16;
+
+    /// Ranges the selection routines narrow down to this length or less are
+    /// finished by sorting them outright.
+    size_t select_small = 32;
+
+    /// Ranges shorter than this are never split across threads by
+    /// `multi_select`.
+    size_t multi_select_parallel_cutoff = 1 << 16;
+
+    /// Subproblems of `closest_pair` with at most this many points are solved
+    /// by brute force.
+    size_t closest_pair_brute_force = 12;
+
+    /// Subproblems with at least this many points solve their halves in
+    /// parallel in `parallel_closest_pair`.
+    size_t closest_pair_parallel_cutoff = 1 << 15;
+
+    /// Largest dimension for which `gemm_batched` interleaves the batch.
+    size_t gemm_interleave_max = 16;
+
+    /// Multiply-adds a single task of `gemm_batched` should perform at least.
+    size_t gemm_batch_task_flops = 1 << 16;
+
+    /// Columns of the packed right operand a low-precision multiply keeps hot
+    /// while it walks over a block of rows.
+    size_t quant_block_cols = 64;
+
+    /// Ranges of the string sorts this short are finished by insertion sort.
+    size_t string_insertion_cutoff = 16;
+
+    /// Ranges this short are handed from `msd_radix_sort` to multikey
+    /// quicksort, where a 257-entry bucket table would cost more than it
+    /// saves.
+    size_t msd_radix_cutoff = 64;
+
+    /// Bytes below which a fill or copy stays on the calling thread.
+    size_t parallel_init_min_bytes = 1 << 20;
+
+    /// Bytes from which fills and copies use streaming stores. Beyond the
+    /// last-level cache the written lines would be evicted before they are
+    /// read again, so writing around the cache saves the read-for-ownership
+    /// traffic.
+    size_t stream_store_min_bytes = 1 << 23;
+
+    /**
+     * @brief Reads a profile from `key = value` lines
+     *
+     * Blank lines and lines starting with '#' are skipped. Keys that are not
+     * listed keep their default; unknown keys are ignored, so an older build
+     * can read a profile written by a newer one.
+     *
+     * @return An error for a malformed line or a value that is not a
+     * positive integer
+     */
+    static auto parse(std::string_view text)
+        -> std::expected<TuningProfile, Error>;
+
+    /// The profile as `key = value` lines, readable by `parse`.
+    [[nodiscard]] auto to_string() const -> std::string;
+
+    bool operator==(const TuningProfile &) const = default;
+};
+
+namespace detail {
+
+inline constexpr std::array<std::pair<std::string_view,
+                                      size_t TuningProfile::*>,
+                            20>
+    TUNING_KEYS = {{
+        {"merge_sort_cutoff", &TuningProfile::merge_sort_cutoff},
+        {"gemm_block_k", &TuningProfile::gemm_block_k},
+        {"gemm_row_grain", &TuningProfile::gemm_row_grain},
+        {"lu_block", &TuningProfile::lu_block},
+        {"lu_parallel_rows", &TuningProfile::lu_parallel_rows},
+        {"gemv_parallel_min", &TuningProfile::gemv_parallel_min},
+        {"reduce_parallel_min", &TuningProfile::reduce_parallel_min},
+        {"scan_parallel_cutoff", &TuningProfile::scan_parallel_cutoff},
+        {"inversions_parallel_cutoff",
+         &TuningProfile::inversions_parallel_cutoff},
+        {"select_small", &TuningProfile::select_small},
+        {"multi_select_parallel_cutoff",
+         &TuningProfile::multi_select_parallel_cutoff},
+        {"closest_pair_brute_force", &TuningProfile::closest_pair_brute_force},
+        {"closest_pair_parallel_cutoff",
+         &TuningProfile::closest_pair_parallel_cutoff},
+        {"gemm_interleave_max", &TuningProfile::gemm_interleave_max},
+        {"gemm_batch_task_flops", &TuningProfile::gemm_batch_task_flops},
+        {"quant_block_cols", &TuningProfile::quant_block_cols},
+        {"string_insertion_cutoff", &TuningProfile::string_insertion_cutoff},
+        {"msd_radix_cutoff", &TuningProfile::msd_radix_cutoff},
+        {"parallel_init_min_bytes", &TuningProfile::parallel_init_min_bytes},
+        {"stream_store_min_bytes", &TuningProfile::stream_store_min_bytes},
+    }};
+
+inline auto trim(std::string_view s) -> std::string_view {
+    size_t first = s.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    size_t last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+} // namespace detail
+
+inline auto TuningProfile::parse(std::string_view text)
+    -> std::expected<TuningProfile, Error> {
+    TuningProfile profile;
+    size_t line_number = 0;
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        std::string_view line = detail::trim(text.substr(0, end));
+        text = end == std::string_view::npos ? std::string_view{}
+                                             : text.substr(end + 1);
+        line_number++;
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        size_t eq = line.find('=');
+        if (eq == std::string_view::npos) {
+            return std::unexpected<Error>(Error::InvalidArgument(std::format(
+                "tuning profile line {}: expected key = value", line_number)));
+        }
+        std::string_view key = detail::trim(line.substr(0, eq));
+        std::string_view value = detail::trim(line.substr(eq + 1));
+        size_t parsed = 0;
+        auto [ptr, ec] =
+            std::from_chars(value.data(), value.data() + value.size(), parsed);
+        if (ec != std::errc{} || ptr != value.data() + value.size() ||
+            parsed == 0) {
+            return std::unexpected<Error>(Error::InvalidArgument(std::format(
+                "tuning profile line {}: '{}' is not a positive integer",
+                line_number, value)));
+        }
+        for (const auto &[name, member] : detail::TUNING_KEYS) {
+            if (name == key) {
+                profile.*member = parsed;
+            }
+        }
+    }
+    return profile;
+}
+
+inline auto TuningProfile::to_string() const -> std::string {
+    std::string text;
+    for (const auto &[name, member] : detail::TUNING_KEYS) {
+        text += std::format("{} = {}\n", name, this->*member);
+    }
+    return text;
+}
+
+/**
+ * @brief Where the tuning profile lives: `$CLRS_TUNING_PROFILE`, else
+ * `$HOME/.config/clrs/tuning.conf`
+ * @return Nothing if neither variable is set
+ */
+inline auto tuning_profile_path() -> std::optional<std::filesystem::path> {
+    if (const char *path = std::getenv(TUNING_PROFILE_ENV);
+        path != nullptr && *path != '\0') {
+        return std::filesystem::path(path);
+    }
+    if (const char *home = std::getenv("HOME");
+        home != nullptr && *home != '\0') {
+        return std::filesystem::path(home) / ".config" / "clrs" /
+               "tuning.conf";
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Reads a profile written by `save_tuning_profile`
+ * @return An error if the file cannot be read or does not parse
+ */
+inline auto load_tuning_profile(const std::filesystem::path &path)
+    -> std::expected<TuningProfile, Error> {
+    std::ifstream in(path);
+    if (!in) {
+        return std::unexpected<Error>(
+            Error::IoError(std::format("cannot read {}", path.string())));
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    return TuningProfile::parse(text.str());
+}
+
+/**
+ * @brief Writes `profile` to `path`, creating its directory
+ * @return An error if the file cannot be written
+ */
+inline auto save_tuning_profile(const TuningProfile &profile,
+                                const std::filesystem::path &path)
+    -> std::expected<void, Error> {
+    std::error_code ec;
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), ec);
+    }
+    std::ofstream out(path);
+    out << "# Written by CLRS --autotune\n" << profile.to_string();
+    out.close();
+    if (ec || !out) {
+        return std::unexpected<Error>(
+            Error::IoError(std::format("cannot write {}", path.string())));
+    }
+    return {};
+}
+
+namespace detail {
+
+/// The profile at `tuning_profile_path()`, or the defaults if there is none
+/// or it does not parse.
+inline auto startup_tuning() -> TuningProfile {
+    auto path = tuning_profile_path();
+    if (!path) {
+        return {};
+    }
+    return load_tuning_profile(*path).value_or(TuningProfile{});
+}
+
+inline auto active_tuning() -> TuningProfile & {
+    static TuningProfile profile = startup_tuning();
+    return profile;
+}
+
+} // namespace detail
+
+/**
+ * @brief The profile the kernels read their parameters from
+ *
+ * Loaded once, on first use; afterwards this is a plain reference. Kernels
+ * read the fields they need on entry.
+ */
+inline auto tuning() -> const TuningProfile & {
+    return detail::active_tuning();
+}
+
+/**
+ * @brief Replaces the active profile
+ *
+ * Not synchronized with running kernels: call it between parallel
+ * operations, not during one.
+ */
+inline void set_tuning(const TuningProfile &profile) {
+    detail::active_tuning() = profile;
+}
+
+#endif // TUNING_HPP
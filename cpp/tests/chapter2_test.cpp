@@ -0,0 +1,633 @@
+#include "chapter2/argsort.hpp"
+#include "chapter2/inversions.hpp"
+#include "chapter2/merge_kernel.hpp"
+#include "chapter2/pair_sum.hpp"
+#include "chapter2/powersort.hpp"
+#include "chapter2/selection.hpp"
+#include "chapter2/sorting_network.hpp"
+#include "chapter2/string_sort.hpp"
+#include "tuning.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct Record {
+    int key;
+    size_t id;
+
+    bool operator<(const Record &other) const { return key < other.key; }
+};
+
+/// An int that counts the comparisons made on it.
+struct Counted {
+    int value;
+    static inline size_t comparisons = 0;
+
+    bool operator<(const Counted &other) const {
+        ++comparisons;
+        return value < other.value;
+    }
+    bool operator==(const Counted &other) const = default;
+};
+
+void test_powersort() {
+    std::cout << "Testing powersort..." << std::endl;
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 1000);
+
+    // Random input, several sizes around the minimum run length
+    for (size_t n : {0ul, 1ul, 2ul, 31ul, 64ul, 65ul, 1000ul, 10007ul}) {
+        std::vector<int> v(n);
+        for (auto &x : v) {
+            x = dist(gen);
+        }
+        auto expected = v;
+        std::sort(expected.begin(), expected.end());
+        powersort(v);
+        assert(v == expected);
+    }
+
+    // Sorted, reverse sorted and appended-to-sorted inputs
+    std::vector<int> sorted(5000);
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        sorted[i] = static_cast<int>(i);
+    }
+    auto v = sorted;
+    powersort(v);
+    assert(v == sorted);
+
+    std::reverse(v.begin(), v.end());
+    powersort(v);
+    assert(v == sorted);
+
+    v = sorted;
+    for (int i = 0; i < 100; ++i) {
+        v.push_back(dist(gen));
+    }
+    auto expected = v;
+    std::sort(expected.begin(), expected.end());
+    powersort(v);
+    assert(v == expected);
+
+    // Stability: equal keys keep their original order
+    std::vector<Record> records(3000);
+    for (size_t i = 0; i < records.size(); ++i) {
+        records[i] = {dist(gen) % 10, i};
+    }
+    powersort(records);
+    for (size_t i = 1; i < records.size(); ++i) {
+        assert(records[i - 1].key <= records[i].key);
+        if (records[i - 1].key == records[i].key) {
+            assert(records[i - 1].id < records[i].id);
+        }
+    }
+
+    // Binary insertion sort on its own
+    std::vector<int> small = {5, 2, 9, 1, 5, 6};
+    binary_insertion_sort(small);
+    assert((small == std::vector<int>{1, 2, 5, 5, 6, 9}));
+
+    std::cout << "✓ Powersort tests passed" << std::endl;
+}
+
+void test_sorting_networks() {
+    std::cout << "Testing sorting networks..." << std::endl;
+
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> dist(-100, 100);
+
+    // Fixed-size network
+    std::array<int, 8> a = {5, -1, 3, 3, 0, 9, -7, 2};
+    sort_network<8>(a.data());
+    assert(std::is_sorted(a.begin(), a.end()));
+
+    // Batched sort for every supported length, with a partial lane group
+    for (size_t n : {1ul, 2ul, 3ul, 8ul, 13ul, 32ul, 64ul, 100ul, 256ul}) {
+        size_t count = 37;
+        std::vector<float> data(n * count);
+        for (auto &x : data) {
+            x = static_cast<float>(dist(gen));
+        }
+        auto expected = data;
+        for (size_t k = 0; k < count; ++k) {
+            std::sort(expected.begin() + k * n, expected.begin() + (k + 1) * n);
+        }
+        assert(sort_batch(std::span<float>(data), n).has_value());
+        assert(data == expected);
+    }
+
+    // Bitonic sort of a non-power-of-two length
+    std::vector<int> v(200);
+    for (auto &x : v) {
+        x = dist(gen);
+    }
+    small_sort(v.data(), v.size());
+    assert(std::is_sorted(v.begin(), v.end()));
+
+    // Lengths past BITONIC_SORT_MAX fall back to std::sort
+    std::vector<int> big(BITONIC_SORT_MAX + 77);
+    for (auto &x : big) {
+        x = dist(gen);
+    }
+    small_sort(big.data(), big.size());
+    assert(std::is_sorted(big.begin(), big.end()));
+
+    // -0.0 and 0.0 compare equal; both must survive the compare-exchanges
+    auto negative_zeros = [](const std::vector<double> &d) {
+        return std::ranges::count_if(d,
+                                     [](double x) { return std::signbit(x); });
+    };
+    for (size_t n : {8ul, 100ul}) {
+        std::vector<double> zeros(n * 19);
+        for (size_t i = 0; i < zeros.size(); ++i) {
+            zeros[i] = i % 3 == 0 ? -0.0 : 0.0;
+        }
+        auto before = negative_zeros(zeros);
+        assert(sort_batch(std::span<double>(zeros), n).has_value());
+        assert(negative_zeros(zeros) == before);
+    }
+    std::vector<double> zeros(200);
+    for (size_t i = 0; i < zeros.size(); ++i) {
+        zeros[i] = i % 2 == 0 ? -0.0 : 0.0;
+    }
+    bitonic_sort(zeros.data(), zeros.size());
+    assert(negative_zeros(zeros) == 100);
+
+    // Invalid batch shapes are rejected
+    std::vector<int> bad(10);
+    assert(!sort_batch(std::span<int>(bad), 3).has_value());
+    assert(!sort_batch(std::span<int>(bad), 0).has_value());
+
+    std::cout << "✓ Sorting network tests passed" << std::endl;
+}
+
+void test_argsort() {
+    std::cout << "Testing argsort and key sorting..." << std::endl;
+
+    std::vector<int> v = {30, 10, 20, 10, 40};
+    auto perm = argsort(v);
+    assert((perm == std::vector<size_t>{1, 3, 2, 0, 4}));
+
+    // Sorting heavy records by a key moves each record into place once
+    std::vector<Record> records = {{3, 0}, {1, 1}, {2, 2}, {1, 3}};
+    sort_by_key(records, [](const Record &r) { return r.key; });
+    assert(records[0].id == 1 && records[1].id == 3);
+    assert(records[2].id == 2 && records[3].id == 0);
+
+    // Paired key/payload arrays
+    std::vector<double> keys = {0.5, -1.0, 2.0};
+    std::vector<std::string> names = {"b", "a", "c"};
+    assert(sort_paired(keys, names).has_value());
+    assert((keys == std::vector<double>{-1.0, 0.5, 2.0}));
+    assert((names == std::vector<std::string>{"a", "b", "c"}));
+
+    // Cycle-following permutation apply, and invalid permutations
+    std::vector<char> letters = {'a', 'b', 'c', 'd'};
+    assert(apply_permutation(letters, {2, 0, 3, 1}).has_value());
+    assert((letters == std::vector<char>{'c', 'a', 'd', 'b'}));
+    assert(!apply_permutation(letters, {0, 0, 1, 2}).has_value());
+    assert(!apply_permutation(letters, {0, 1}).has_value());
+
+    std::cout << "✓ Argsort tests passed" << std::endl;
+}
+
+void test_selection() {
+    std::cout << "Testing selection and top-k..." << std::endl;
+
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<int> dist(0, 500);
+    std::vector<int> v(200000);
+    for (auto &x : v) {
+        x = dist(gen);
+    }
+    auto sorted = v;
+    std::sort(sorted.begin(), sorted.end());
+
+    for (size_t k : {0ul, 1ul, 777ul, 100000ul, 199999ul}) {
+        auto a = v;
+        assert(introselect(a, k) == sorted[k]);
+        assert(std::all_of(a.begin(), a.begin() + k,
+                           [&](int x) { return x <= sorted[k]; }));
+        auto b = v;
+        assert(floyd_rivest_select(b, k) == sorted[k]);
+    }
+    assert(!introselect(v, v.size()).has_value());
+
+    // Median-of-medians fallback on an adversarial (all equal + sorted) input
+    std::vector<int> organ(100000);
+    for (size_t i = 0; i < organ.size(); ++i) {
+        organ[i] = static_cast<int>(i < 50000 ? i : 100000 - i);
+    }
+    auto organ_sorted = organ;
+    std::sort(organ_sorted.begin(), organ_sorted.end());
+    assert(introselect(organ, 31337) == organ_sorted[31337]);
+
+    // Linear comparison counts on inputs that unbalance median-of-three
+    for (int shape = 0; shape < 3; ++shape) {
+        std::vector<Counted> c(100000);
+        for (size_t i = 0; i < c.size(); ++i) {
+            int x = static_cast<int>(i);
+            c[i].value = shape == 0   ? x
+                         : shape == 1 ? (i < 50000 ? x : 100000 - x)
+                                      : (i % 2 == 0 ? x : 100000 - x);
+        }
+        auto expected = c;
+        std::sort(expected.begin(), expected.end());
+        Counted::comparisons = 0;
+        assert(introselect(c, 70001) == expected[70001]);
+        assert(Counted::comparisons < 40 * c.size());
+    }
+
+    auto p = v;
+    partial_sort(p, 1000);
+    assert(std::equal(p.begin(), p.begin() + 1000, sorted.begin()));
+
+    auto top = top_k(v, 50);
+    assert(std::equal(top.begin(), top.end(), sorted.begin()));
+
+    auto m = v;
+    auto picked = multi_select(m, {199999, 0, 100000, 500000, 50000});
+    assert(picked[0] == sorted[199999] && picked[1] == sorted[0]);
+    assert(picked[2] == sorted[100000] && !picked[3].has_value());
+    assert(picked[4] == sorted[50000]);
+
+    // Any small-range and fork cutoffs from the tuning profile
+    TuningProfile original = tuning();
+    for (size_t small : {1ul, 5ul, 200ul}) {
+        TuningProfile profile = original;
+        profile.select_small = small;
+        profile.multi_select_parallel_cutoff = 1000;
+        set_tuning(profile);
+        auto a = v;
+        assert(introselect(a, 777) == sorted[777]);
+        auto b = v;
+        partial_sort(b, 150);
+        assert(std::equal(b.begin(), b.begin() + 150, sorted.begin()));
+        auto c = v;
+        auto ranks = multi_select(c, {3, 100000, 150000, 199998});
+        assert(ranks[0] == sorted[3] && ranks[1] == sorted[100000]);
+        assert(ranks[2] == sorted[150000] && ranks[3] == sorted[199998]);
+    }
+    set_tuning(original);
+
+    auto q = v;
+    auto qs = quantiles(q, {0.0, 0.5, 1.0});
+    assert(qs[0] == sorted.front() && qs[2] == sorted.back());
+
+    std::cout << "✓ Selection tests passed" << std::endl;
+}
+
+void test_inversions() {
+    std::cout << "Testing inversion counting..." << std::endl;
+
+    assert(count_inversions(std::vector<int>{2, 3, 8, 6, 1}) == 5);
+    assert(count_inversions(std::vector<int>{}) == 0);
+
+    std::vector<int> reversed(1000);
+    for (size_t i = 0; i < reversed.size(); ++i) {
+        reversed[i] = static_cast<int>(reversed.size() - i);
+    }
+    assert(count_inversions(reversed) == 1000ull * 999 / 2);
+
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<int> dist(0, 1 << 20);
+    std::vector<int> v(300000);
+    for (auto &x : v) {
+        x = dist(gen);
+    }
+    uint64_t serial = count_inversions(v);
+    assert(parallel_count_inversions(v) == serial);
+    TuningProfile original = tuning();
+    TuningProfile profile = original;
+    profile.inversions_parallel_cutoff = 64;
+    set_tuning(profile);
+    assert(parallel_count_inversions(v) == serial);
+    set_tuning(original);
+
+    StreamingInversionCounter stream((1 << 20) + 1);
+    for (int x : v) {
+        assert(stream.push(static_cast<size_t>(x)).has_value());
+    }
+    assert(stream.inversions() == serial);
+    assert(!stream.push(size_t{1} << 40).has_value());
+
+    // Kendall tau: one swapped pair, and a full reversal
+    std::vector<int> a = {1, 2, 3, 4};
+    assert(kendall_tau_distance(a, std::vector<int>{1, 3, 2, 4}) == 1u);
+    assert(kendall_tau_distance(a, std::vector<int>{4, 3, 2, 1}) == 6u);
+    assert(!kendall_tau_distance(a, std::vector<int>{1}).has_value());
+
+    std::cout << "✓ Inversion counting tests passed" << std::endl;
+}
+
+void test_string_sorts() {
+    std::cout << "Testing string sorts..." << std::endl;
+
+    std::mt19937 gen(11);
+    auto random_strings = [&](size_t n, size_t prefix) {
+        std::uniform_int_distribution<int> len(0, 12);
+        std::uniform_int_distribution<int> ch(0, 3);
+        std::vector<std::string> out;
+        std::string shared(prefix, 'p');
+        for (size_t i = 0; i < n; ++i) {
+            std::string s = shared;
+            int l = len(gen);
+            for (int c = 0; c < l; ++c) {
+                // A small alphabet (with '\0' and a high byte) forces long
+                // common prefixes and many duplicates
+                const char alphabet[] = {'\0', 'a', 'b', '\xe9'};
+                s.push_back(alphabet[ch(gen)]);
+            }
+            out.push_back(s);
+        }
+        return out;
+    };
+
+    for (size_t n : {0ul, 1ul, 15ul, 100ul, 5000ul}) {
+        for (size_t prefix : {0ul, 40ul}) {
+            auto input = random_strings(n, prefix);
+            auto expected = input;
+            std::sort(expected.begin(), expected.end());
+
+            auto a = input;
+            multikey_quicksort(a);
+            assert(a == expected);
+
+            auto b = input;
+            msd_radix_sort(b);
+            assert(b == expected);
+
+            auto c = input;
+            auto lcp = lcp_merge_sort(c);
+            assert(c == expected);
+            for (size_t i = 1; i < n; ++i) {
+                size_t h = 0;
+                while (h < c[i].size() && h < c[i - 1].size() &&
+                       c[i][h] == c[i - 1][h]) {
+                    ++h;
+                }
+                assert(lcp[i] == h);
+            }
+
+            auto views = sorted_views(input);
+            assert(std::equal(views.begin(), views.end(), expected.begin(),
+                              expected.end()));
+        }
+    }
+
+    // Views sort without touching the strings they point to
+    std::vector<std::string_view> svs = {"pear", "apple", "fig", "apples"};
+    multikey_quicksort(svs);
+    assert((svs == std::vector<std::string_view>{"apple", "apples", "fig",
+                                                 "pear"}));
+
+    // The arena copies each string once; its views stay valid as it grows
+    StringArena arena;
+    auto words = random_strings(3000, 20);
+    std::string_view first = arena.push(words[0]);
+    for (size_t i = 1; i < words.size(); ++i) {
+        arena.push(words[i]);
+    }
+    arena.push(std::string(STRING_ARENA_BLOCK + 5, 'z'));
+    assert(first == words[0]);
+    assert(arena.size() == words.size() + 1);
+    arena.sort();
+    words.push_back(std::string(STRING_ARENA_BLOCK + 5, 'z'));
+    std::sort(words.begin(), words.end());
+    assert(std::equal(arena.views().begin(), arena.views().end(),
+                      words.begin(), words.end()));
+
+    // An empty string as the very first push still gets a block
+    StringArena empty_first;
+    assert(empty_first.push("").empty());
+    assert(empty_first.push("ab") == "ab");
+    empty_first.sort();
+    assert((empty_first.views() == std::vector<std::string_view>{"", "ab"}));
+
+    std::cout << "✓ String sort tests passed" << std::endl;
+}
+
+template <typename T> void check_merge_kernel(std::mt19937 &gen) {
+    std::uniform_int_distribution<int> dist(-50, 50);
+    for (size_t na : {0ul, 1ul, 7ul, 8ul, 9ul, 100ul, 1000ul}) {
+        for (size_t nb : {0ul, 3ul, 8ul, 33ul, 1001ul}) {
+            std::vector<T> a(na);
+            std::vector<T> b(nb);
+            for (auto &x : a) {
+                x = static_cast<T>(dist(gen));
+            }
+            for (auto &x : b) {
+                x = static_cast<T>(dist(gen));
+            }
+            std::sort(a.begin(), a.end());
+            std::sort(b.begin(), b.end());
+            std::vector<T> expected(na + nb);
+            std::merge(a.begin(), a.end(), b.begin(), b.end(),
+                       expected.begin());
+
+            std::vector<T> out(na + nb);
+            merge_kernel(a.data(), na, b.data(), nb, out.data());
+            assert(out == expected);
+
+            // In place: the right run already sits at the end of the output
+            std::vector<T> in_place(na + nb);
+            std::copy(b.begin(), b.end(), in_place.begin() + na);
+            merge_kernel(a.data(), na, in_place.data() + na, nb,
+                         in_place.data());
+            assert(in_place == expected);
+        }
+    }
+}
+
+void test_merge_kernel() {
+    std::cout << "Testing merge kernel..." << std::endl;
+
+    std::mt19937 gen(5);
+    check_merge_kernel<int32_t>(gen);
+    check_merge_kernel<float>(gen);
+    check_merge_kernel<double>(gen);
+    check_merge_kernel<int64_t>(gen);
+    check_merge_kernel<int8_t>(gen);
+
+    // merge_sort and powersort pick the kernel up for arithmetic types
+    std::uniform_int_distribution<int> dist(-1000000, 1000000);
+    std::vector<int> v(100003);
+    for (auto &x : v) {
+        x = dist(gen);
+    }
+    auto expected = v;
+    std::sort(expected.begin(), expected.end());
+    auto by_merge_sort = v;
+    merge_sort(by_merge_sort);
+    assert(by_merge_sort == expected);
+    // Any insertion sort cutoff from the tuning profile
+    TuningProfile original = tuning();
+    for (size_t cutoff : {1, 7, 64}) {
+        TuningProfile profile = original;
+        profile.merge_sort_cutoff = cutoff;
+        set_tuning(profile);
+        by_merge_sort = v;
+        merge_sort(by_merge_sort);
+        assert(by_merge_sort == expected);
+    }
+    set_tuning(original);
+    std::vector<double> d(v.begin(), v.end());
+    powersort(d);
+    assert(std::equal(d.begin(), d.end(), expected.begin(), expected.end()));
+
+    // -0.0 and 0.0 compare equal but must both survive the SIMD path
+    std::bernoulli_distribution negative(0.5);
+    std::vector<double> zeros(1000);
+    for (auto &x : zeros) {
+        x = negative(gen) ? -0.0 : 0.0;
+    }
+    zeros[3] = 1.0;
+    zeros[500] = -1.0;
+    auto count_negative = [](const auto &arr) {
+        return std::count_if(arr.begin(), arr.end(),
+                             [](auto x) { return std::signbit(x); });
+    };
+    auto negatives = count_negative(zeros);
+    auto zeros_sorted = zeros;
+    merge_sort(zeros_sorted);
+    assert(count_negative(zeros_sorted) == negatives);
+    zeros_sorted = zeros;
+    powersort(zeros_sorted);
+    assert(count_negative(zeros_sorted) == negatives);
+    std::vector<float> float_zeros(zeros.begin(), zeros.end());
+    merge_sort(float_zeros);
+    assert(count_negative(float_zeros) == negatives);
+
+    std::cout << "✓ Merge kernel tests passed" << std::endl;
+}
+
+/// Every pair (i, j), i < j, with arr[i] + arr[j] == x, by brute force.
+template <typename T>
+auto brute_force_pairs(const std::vector<T> &arr, T x)
+    -> std::vector<std::pair<size_t, size_t>> {
+    std::vector<std::pair<size_t, size_t>> out;
+    for (size_t i = 0; i < arr.size(); i++) {
+        for (size_t j = i + 1; j < arr.size(); j++) {
+            if (static_cast<long double>(arr[i]) + arr[j] ==
+                static_cast<long double>(x)) {
+                out.emplace_back(i, j);
+            }
+        }
+    }
+    return out;
+}
+
+void test_pair_sum() {
+    std::cout << "Testing pair sum..." << std::endl;
+
+    // Exercise 2.3-8
+    std::vector<int> arr = {8, 1, 5, 3, 5, 7};
+    assert(has_pair_with_sum(arr, 10));
+    assert(has_pair_with_sum(arr, 4));
+    assert(!has_pair_with_sum(arr, 2));
+    assert(!has_pair_with_sum(arr, 16));
+    assert(!has_pair_with_sum(std::vector<int>{}, 0));
+    assert(!has_pair_with_sum(std::vector<int>{5}, 10));
+
+    std::mt19937 gen(11);
+    for (auto backend : {PairSumBackend::Sorted, PairSumBackend::Hashed}) {
+        PairSumIndex<int> index(arr, backend);
+        assert(index.size() == arr.size());
+        assert(index.count(10) == 2); // (2, 4), (3, 5)
+        using P = std::pair<size_t, size_t>;
+        assert((index.pairs(10) == std::vector<P>{{2, 4}, {3, 5}}));
+        assert(index.count(2) == 0 && index.pairs(2).empty());
+
+        // Many duplicates and negative values against brute force
+        for (int n : {0, 1, 2, 17, 300}) {
+            std::uniform_int_distribution<int> dist(-20, 20);
+            std::vector<int> v(n);
+            for (auto &x : v) {
+                x = dist(gen);
+            }
+            PairSumIndex<int> idx(v, backend);
+            std::vector<int> targets;
+            for (int x = -45; x <= 45; x++) {
+                targets.push_back(x);
+                auto expected = brute_force_pairs(v, x);
+                assert(idx.pairs(x) == expected);
+                assert(idx.count(x) == expected.size());
+                assert(idx.contains(x) == !expected.empty());
+            }
+            auto found = idx.contains(std::span<const int>(targets));
+            auto counts = idx.count(std::span<const int>(targets));
+            for (size_t q = 0; q < targets.size(); q++) {
+                assert(found[q] == idx.contains(targets[q]));
+                assert(counts[q] == idx.count(targets[q]));
+            }
+        }
+
+        // Sums beyond the range of T never overflow
+        std::vector<int8_t> small = {127, 127, -128, 100, -1};
+        PairSumIndex<int8_t> bytes(small, backend);
+        assert(bytes.count(-2) == 0);
+        assert(bytes.count(126) == 2);
+        assert(bytes.count(-1) == 2); // (0, 2), (1, 2)
+        std::vector<uint64_t> wide = {UINT64_MAX, 1, UINT64_MAX - 1, 2};
+        PairSumIndex<uint64_t> words(wide, backend);
+        assert(words.count(0) == 0);
+        assert(words.count(UINT64_MAX) == 1); // (1, 2)
+        assert(words.count(3) == 1);
+
+        // Large batch spread over the pool
+        std::uniform_int_distribution<int64_t> big(-1000000, 1000000);
+        std::vector<int64_t> values(20000);
+        for (auto &x : values) {
+            x = big(gen);
+        }
+        PairSumIndex<int64_t> large(values, backend);
+        std::vector<int64_t> queries(200);
+        for (size_t q = 0; q < queries.size(); q++) {
+            queries[q] = q % 2 == 0 ? values[q] + values[q + 1] : big(gen);
+        }
+        auto hits = large.contains(std::span<const int64_t>(queries));
+        for (size_t q = 0; q < queries.size(); q += 2) {
+            assert(hits[q]);
+        }
+        auto totals = large.count(std::span<const int64_t>(queries));
+        for (size_t q = 0; q < queries.size(); q += 37) {
+            assert(totals[q] == brute_force_pairs(values, queries[q]).size());
+        }
+    }
+
+    std::cout << "✓ Pair sum tests passed" << std::endl;
+}
+
+int main() {
+    try {
+        test_powersort();
+        test_sorting_networks();
+        test_argsort();
+        test_selection();
+        test_inversions();
+        test_string_sorts();
+        test_merge_kernel();
+        test_pair_sum();
+
+        std::cout << "All tests passed successfully!" << std::endl;
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "Test failed with unknown exception" << std::endl;
+        return 1;
+    }
+}
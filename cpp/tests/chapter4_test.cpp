@@ -0,0 +1,117 @@
+#include "chapter4/chapter4.hpp"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+double brute_force_distance(const std::vector<double> &xs,
+                            const std::vector<double> &ys) {
+    double best = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < xs.size(); ++i) {
+        for (size_t j = i + 1; j < xs.size(); ++j) {
+            best = std::min(best, std::hypot(xs[i] - xs[j], ys[i] - ys[j]));
+        }
+    }
+    return best;
+}
+
+void check_pair(const ClosestPair &pair, const std::vector<double> &xs,
+                const std::vector<double> &ys, double expected) {
+    assert(pair.first < pair.second && pair.second < xs.size());
+    assert(std::abs(pair.distance - expected) <= 1e-12 * (1.0 + expected));
+    double d = std::hypot(xs[pair.first] - xs[pair.second],
+                          ys[pair.first] - ys[pair.second]);
+    assert(std::abs(d - pair.distance) <= 1e-12 * (1.0 + d));
+}
+
+void test_closest_pair() {
+    std::cout << "Testing closest pair..." << std::endl;
+
+    std::mt19937 gen(17);
+    std::uniform_real_distribution<double> coord(-1000.0, 1000.0);
+    std::uniform_int_distribution<int> lattice(0, 30);
+
+    for (size_t n : {2ul, 3ul, 13ul, 100ul, 2000ul}) {
+        // Continuous points, and lattice points with many shared x values
+        for (bool on_lattice : {false, true}) {
+            std::vector<double> xs(n);
+            std::vector<double> ys(n);
+            for (size_t i = 0; i < n; ++i) {
+                xs[i] = on_lattice ? lattice(gen) : coord(gen);
+                ys[i] = on_lattice ? lattice(gen) * 0.5 : coord(gen);
+            }
+            double expected = brute_force_distance(xs, ys);
+            check_pair(*closest_pair(xs, ys), xs, ys, expected);
+            check_pair(*parallel_closest_pair(xs, ys), xs, ys, expected);
+            check_pair(*closest_pair_grid(xs, ys, n), xs, ys, expected);
+        }
+    }
+
+    // Large enough for the parallel split; a planted pair is the answer
+    size_t n = 100000;
+    std::vector<double> xs(n);
+    std::vector<double> ys(n);
+    for (size_t i = 0; i < n; ++i) {
+        xs[i] = static_cast<double>(i % 400) * 10.0;
+        ys[i] = static_cast<double>(i / 400) * 10.0;
+    }
+    xs[54321] = xs[12345] + 0.3;
+    ys[54321] = ys[12345] + 0.4;
+    for (auto result : {closest_pair(xs, ys), parallel_closest_pair(xs, ys),
+                        closest_pair_grid(xs, ys)}) {
+        assert(result.has_value());
+        assert(result->first == 12345 && result->second == 54321);
+        assert(std::abs(result->distance - 0.5) < 1e-9);
+    }
+
+    // Any brute-force and fork cutoffs from the tuning profile
+    std::vector<double> px(3000);
+    std::vector<double> py(3000);
+    for (size_t i = 0; i < px.size(); ++i) {
+        px[i] = lattice(gen);
+        py[i] = coord(gen);
+    }
+    double expected = brute_force_distance(px, py);
+    TuningProfile original = tuning();
+    for (size_t brute_force : {1ul, 2ul, 40ul}) {
+        TuningProfile profile = original;
+        profile.closest_pair_brute_force = brute_force;
+        profile.closest_pair_parallel_cutoff = 100;
+        set_tuning(profile);
+        check_pair(*closest_pair(px, py), px, py, expected);
+        check_pair(*parallel_closest_pair(px, py), px, py, expected);
+    }
+    set_tuning(original);
+
+    // Duplicates are at distance zero
+    std::vector<double> dx = {1.0, 5.0, 3.0, 5.0};
+    std::vector<double> dy = {1.0, 2.0, 7.0, 2.0};
+    assert(closest_pair(dx, dy)->distance == 0.0);
+    assert(closest_pair_grid(dx, dy)->distance == 0.0);
+
+    // Invalid input
+    assert(!closest_pair({1.0}, {1.0}).has_value());
+    assert(!closest_pair({1.0, 2.0}, {1.0}).has_value());
+    assert(!closest_pair_grid({1.0, NAN}, {1.0, 2.0}).has_value());
+
+    std::cout << "✓ Closest pair tests passed" << std::endl;
+}
+
+int main() {
+    try {
+        test_closest_pair();
+
+        std::cout << "All tests passed successfully!" << std::endl;
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "Test failed with unknown exception" << std::endl;
+        return 1;
+    }
+}
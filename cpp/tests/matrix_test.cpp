@@ -1,6 +1,23 @@
+#include "autotune.hpp"
+#include "batched_gemm.hpp"
+#include "linalg.hpp"
 #include "matrix.hpp"
+#include "matrix_power.hpp"
+#include "memory.hpp"
+#include "quantized.hpp"
+#include "reduction.hpp"
+#include "tuning.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <string>
 #include <cassert>
+#include <cstdlib>
+#include <filesystem>
 #include <stdexcept>
 
 void test_basic_construction() {
@@ -221,8 +238,597 @@ void test_edge_cases() {
     std::cout << "✓ Edge case tests passed" << std::endl;
 }
 
+Matrix<double> random_matrix(size_t rows, size_t cols, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    Matrix<double> m(rows, cols);
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < cols; ++j) {
+            m(i, j) = dist(gen);
+        }
+    }
+    return m;
+}
+
+void test_gemm() {
+    std::cout << "Testing matrix multiplication..." << std::endl;
+
+    auto a = random_matrix(70, 300, 1);
+    auto b = random_matrix(300, 45, 2);
+    auto c = matmul(a, b);
+    assert(c.has_value());
+    for (size_t i = 0; i < 70; i += 7) {
+        for (size_t j = 0; j < 45; j += 5) {
+            double expected = 0.0;
+            for (size_t k = 0; k < 300; ++k) {
+                expected += a(i, k) * b(k, j);
+            }
+            assert(std::abs((*c)(i, j) - expected) < 1e-9);
+        }
+    }
+
+    // Shape mismatch
+    assert(!matmul(a, a).has_value());
+
+    std::cout << "✓ Matrix multiplication tests passed" << std::endl;
+}
+
+void test_lu() {
+    std::cout << "Testing LU decomposition..." << std::endl;
+
+    // Larger than one panel, so the blocked path and the gemm update run
+    size_t n = 150;
+    auto a = random_matrix(n, n, 3);
+    auto lu = LuDecomposition<double>::factor(a);
+    assert(lu.has_value());
+
+    std::vector<double> x_true(n);
+    for (size_t i = 0; i < n; ++i) {
+        x_true[i] = static_cast<double>(i % 10) - 4.5;
+    }
+    std::vector<double> rhs(n, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            rhs[i] += a(i, j) * x_true[j];
+        }
+    }
+    auto x = lu->solve(rhs);
+    assert(x.has_value());
+    for (size_t i = 0; i < n; ++i) {
+        assert(std::abs((*x)[i] - x_true[i]) < 1e-8);
+    }
+
+    // A * A^-1 == I
+    auto product = matmul(a, lu->inverse());
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            assert(std::abs((*product)(i, j) - (i == j ? 1.0 : 0.0)) < 1e-8);
+        }
+    }
+
+    // Determinant of a known matrix (needs a row swap)
+    Matrix<double> small(3, 3);
+    double values[] = {0, 2, 1, 1, 1, 1, 2, 1, 3};
+    std::copy(values, values + 9, small.data());
+    assert(std::abs(LuDecomposition<double>::factor(small)->determinant() +
+                    3.0) < 1e-12);
+
+    // Singular and non-square inputs
+    Matrix<double> singular(3, 3, 1.0);
+    assert(!LuDecomposition<double>::factor(singular).has_value());
+    Matrix<double> wide(2, 3, 1.0);
+    assert(!LuDecomposition<double>::factor(wide).has_value());
+
+    std::cout << "✓ LU decomposition tests passed" << std::endl;
+}
+
+void test_matrix_power() {
+    std::cout << "Testing matrix power..." << std::endl;
+
+    // Repeated squaring agrees with repeated multiplication
+    auto a = random_matrix(20, 20, 4);
+    for (size_t i = 0; i < 20; ++i) {
+        for (size_t j = 0; j < 20; ++j) {
+            a(i, j) /= 10.0;
+        }
+    }
+    Matrix<double> naive = *matrix_power(a, 0);
+    for (size_t i = 0; i < 20; ++i) {
+        assert(naive(i, i) == 1.0);
+    }
+    for (int k = 0; k < 13; ++k) {
+        naive = *matmul(naive, a);
+    }
+    auto fast = matrix_power(a, 13);
+    assert(fast.has_value());
+    for (size_t i = 0; i < 20; ++i) {
+        for (size_t j = 0; j < 20; ++j) {
+            assert(std::abs((*fast)(i, j) - naive(i, j)) <=
+                   1e-9 * (1.0 + std::abs(naive(i, j))));
+        }
+    }
+    assert(!matrix_power(Matrix<double>(2, 3), 2).has_value());
+
+    // Fibonacci: [[1, 1], [1, 0]]^n holds F(n+1), F(n), F(n-1)
+    Matrix<uint64_t> fib(2, 2, 1);
+    fib(1, 1) = 0;
+    assert((*matrix_power(fib, 90))(0, 1) == 2880067194370816120ULL);
+    // F(1000) mod 1e9+7 and a modulus above 2^32
+    assert((*matrix_power_mod(fib, 1000, 1000000007))(0, 1) == 517691607);
+    uint64_t big = (1ULL << 61) - 1;
+    auto fib_big = matrix_power_mod(fib, 90, big);
+    assert((*fib_big)(0, 1) == 2880067194370816120ULL % big);
+    assert(!matrix_power_mod(fib, 3, 0).has_value());
+
+    // Cached squares: vectors and batches against the direct power
+    auto cache = MatrixPowerCache<double>::create(a);
+    assert(cache.has_value());
+    Matrix<double> vectors = random_matrix(5, 20, 5);
+    auto batch = cache->batch_power(vectors, 13);
+    assert(batch.has_value());
+    for (size_t r = 0; r < 5; ++r) {
+        std::vector<double> v(vectors.data() + r * 20,
+                              vectors.data() + (r + 1) * 20);
+        auto single = cache->vector_power(v, 13);
+        assert(single.has_value());
+        for (size_t j = 0; j < 20; ++j) {
+            double expected = 0.0;
+            for (size_t p = 0; p < 20; ++p) {
+                expected += v[p] * naive(p, j);
+            }
+            double tol = 1e-9 * (1.0 + std::abs(expected));
+            assert(std::abs((*single)[j] - expected) <= tol);
+            assert(std::abs((*batch)(r, j) - expected) <= tol);
+        }
+    }
+    assert(!cache->vector_power(std::vector<double>(3), 2).has_value());
+
+    // Linear recurrences: Fibonacci and a(n) = 2a(n-1) - a(n-2) + a(n-3)
+    std::vector<int64_t> fib_coeffs = {1, 1};
+    std::vector<int64_t> fib_init = {0, 1};
+    assert(*linear_recurrence(fib_coeffs, fib_init, 0) == 0);
+    assert(*linear_recurrence(fib_coeffs, fib_init, 1) == 1);
+    assert(*linear_recurrence(fib_coeffs, fib_init, 50) == 12586269025LL);
+    std::vector<int64_t> coeffs = {2, -1, 1};
+    std::vector<int64_t> seq = {1, 0, 3};
+    for (size_t i = 3; i < 40; ++i) {
+        seq.push_back(2 * seq[i - 1] - seq[i - 2] + seq[i - 3]);
+    }
+    for (size_t i = 0; i < 40; ++i) {
+        assert(*linear_recurrence(coeffs, {1, 0, 3}, i) == seq[i]);
+    }
+    assert(!linear_recurrence(coeffs, fib_init, 5).has_value());
+
+    std::cout << "✓ Matrix power tests passed" << std::endl;
+}
+
+void test_gemm_batched() {
+    std::cout << "Testing batched matrix multiplication..." << std::endl;
+
+    std::mt19937 gen(6);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    // Interleaved sizes (with a leftover partial group) and a larger size
+    for (auto [count, m, k, n] : {std::array<size_t, 4>{1003, 8, 8, 8},
+                                  std::array<size_t, 4>{37, 3, 5, 2},
+                                  std::array<size_t, 4>{20, 40, 33, 24}}) {
+        MatrixBatch<double> a(count, m, k);
+        MatrixBatch<double> b(count, k, n);
+        MatrixBatch<double> c(count, m, n);
+        for (size_t i = 0; i < count * m * k; ++i) {
+            a.data()[i] = dist(gen);
+        }
+        for (size_t i = 0; i < count * k * n; ++i) {
+            b.data()[i] = dist(gen);
+        }
+        for (size_t i = 0; i < count * m * n; ++i) {
+            c.data()[i] = dist(gen);
+        }
+        MatrixBatch<double> before = c;
+        assert(gemm_batched(2.0, a.view(), b.view(), 0.5, c.view_mut())
+                   .has_value());
+        for (size_t t = 0; t < count; t += 7) {
+            for (size_t i = 0; i < m; ++i) {
+                for (size_t j = 0; j < n; ++j) {
+                    double expected = 0.5 * before(t, i, j);
+                    for (size_t p = 0; p < k; ++p) {
+                        expected += 2.0 * a(t, i, p) * b(t, p, j);
+                    }
+                    assert(std::abs(c(t, i, j) - expected) < 1e-9);
+                }
+            }
+        }
+        auto product = matmul_batched(a, b);
+        assert(product.has_value());
+        assert(product->count() == count && product->ncols() == n);
+    }
+
+    // Strided batch: every other 4x4 block of a buffer
+    std::vector<float> buf(10 * 32, 1.0f);
+    std::vector<float> out(10 * 16, 0.0f);
+    StridedBatch<const float> sa{buf, 10, 4, 4, 32};
+    StridedBatch<float> sc{out, 10, 4, 4, 16};
+    assert(gemm_batched(1.0f, sa, sa, 0.0f, sc).has_value());
+    assert(std::all_of(out.begin(), out.end(),
+                       [](float x) { return x == 4.0f; }));
+
+    // Mismatched shapes, counts and too-short storage
+    MatrixBatch<double> x(4, 2, 3);
+    MatrixBatch<double> y(5, 3, 2);
+    assert(!matmul_batched(x, y).has_value());
+    assert(!matmul_batched(x, x).has_value());
+    StridedBatch<const float> overrun{buf, 11, 4, 4, 32};
+    assert(!gemm_batched(1.0f, overrun, overrun, 0.0f, sc).has_value());
+
+    std::cout << "✓ Batched matrix multiplication tests passed" << std::endl;
+}
+
+void test_quantized() {
+    std::cout << "Testing low-precision matrices..." << std::endl;
+
+    // Conversions
+    assert(BFloat16::from_float(1.0f).bits == 0x3f80);
+    assert(BFloat16::from_float(-2.5f).to_float() == -2.5f);
+    assert(Float16::from_float(1.0f).bits == 0x3c00);
+    assert(Float16::from_float(65504.0f).bits == 0x7bff);
+    assert(Float16::from_float(1e5f).bits == 0x7c00);
+    assert(Float16::from_float(0x1p-24f).bits == 0x0001);
+    assert(Float16::from_float(-0.333251953125f).to_float() ==
+           -0.333251953125f);
+
+    // Reference products are computed in double
+    auto to_float = [](const Matrix<double> &m) {
+        Matrix<float> f(m.nrows(), m.ncols());
+        for (size_t i = 0; i < m.nrows() * m.ncols(); ++i) {
+            f.data()[i] = static_cast<float>(m.data()[i]);
+        }
+        return f;
+    };
+    auto a64 = random_matrix(70, 300, 7);
+    auto b64 = random_matrix(300, 45, 8);
+    for (size_t i = 0; i < 300 * 45; ++i) {
+        b64.data()[i] = 0.25 * b64.data()[i] + 0.5; // non-zero zero point
+    }
+    auto a = to_float(a64);
+    auto b = to_float(b64);
+    auto reference = *matmul(a64, b64);
+
+    auto qa8 = QuantizedMatrix<int8_t>::quantize(a);
+    auto qb8 = QuantizedMatrix<int8_t>::quantize(b);
+    assert(qa8.has_value() && qb8.has_value());
+    assert(qb8->params().zero_point != 0);
+    auto c8 = quantized_matmul(*qa8, *qb8);
+    assert(c8.has_value());
+    assert(measure_accuracy(reference, *c8)->relative_error < 2e-2);
+
+    auto qa16 = QuantizedMatrix<int16_t>::quantize(a);
+    auto qb16 = QuantizedMatrix<int16_t>::quantize(b);
+    auto c16 = quantized_matmul(*qa16, *qb16);
+    assert(measure_accuracy(reference, *c16)->relative_error < 1e-4);
+
+    // The kernels compute exactly what the dequantized operands give
+    auto exact = *matmul(qa8->dequantize(), qb8->dequantize());
+    for (size_t i = 0; i < 70 * 45; ++i) {
+        assert(std::abs(exact.data()[i] - c8->data()[i]) < 1e-3);
+    }
+
+    auto cbf = half_matmul(HalfMatrix<BFloat16>::from_float(a),
+                           HalfMatrix<BFloat16>::from_float(b));
+    assert(cbf.has_value());
+    assert(measure_accuracy(reference, *cbf)->relative_error < 1e-2);
+    auto cf16 = half_matmul(HalfMatrix<Float16>::from_float(a),
+                            HalfMatrix<Float16>::from_float(b));
+    assert(measure_accuracy(reference, *cf16)->relative_error < 2e-3);
+
+    // Errors
+    assert(!quantized_matmul(*qa8, *qa8).has_value());
+    assert(!QuantizedMatrix<int8_t>::quantize(a, {0.0f, 0}).has_value());
+    assert(!QuantizedMatrix<int8_t>::quantize(a, {1.0f, 300}).has_value());
+    Matrix<float> bad(1, 1, std::numeric_limits<float>::infinity());
+    assert(!QuantizedMatrix<int8_t>::quantize(bad).has_value());
+    assert(!measure_accuracy(reference, a).has_value());
+
+    std::cout << "✓ Low-precision matrix tests passed" << std::endl;
+}
+
+void test_gemv_and_reductions() {
+    std::cout << "Testing gemv and reductions..." << std::endl;
+
+    // Small, wide, and tall enough for the parallel paths
+    for (auto [rows, cols] : {std::pair<size_t, size_t>{7, 5},
+                              std::pair<size_t, size_t>{33, 1000},
+                              std::pair<size_t, size_t>{60001, 3}}) {
+        auto a = random_matrix(rows, cols, rows + cols);
+        std::vector<double> x(cols);
+        std::vector<double> xt(rows);
+        for (size_t j = 0; j < cols; ++j) {
+            x[j] = static_cast<double>(j % 7) - 3.0;
+        }
+        for (size_t i = 0; i < rows; ++i) {
+            xt[i] = static_cast<double>(i % 5) - 2.0;
+        }
+        std::vector<double> y(rows, 1.0);
+        std::vector<double> yt(cols, 1.0);
+        assert(gemv(2.0, full_view(a), std::span<const double>(x), 0.5,
+                    std::span<double>(y))
+                   .has_value());
+        assert(gemv_transposed(1.0, full_view(a), std::span<const double>(xt),
+                               0.0, std::span<double>(yt))
+                   .has_value());
+
+        auto sums = row_sums(a);
+        auto csums = col_sums(a);
+        auto norms = row_norms(a);
+        auto cnorms = col_norms(a);
+        auto mins = *row_min(a);
+        auto maxs = *row_max(a);
+        auto cmins = *col_min(a);
+        auto cmaxs = *col_max(a);
+        std::vector<double> expected_yt(cols, 0.0);
+        std::vector<double> expected_csum(cols, 0.0);
+        std::vector<double> expected_cnorm(cols, 0.0);
+        for (size_t i = 0; i < rows; ++i) {
+            double dot = 0.0;
+            double sum = 0.0;
+            double sq = 0.0;
+            double lo = a(i, 0);
+            double hi = a(i, 0);
+            for (size_t j = 0; j < cols; ++j) {
+                double v = a(i, j);
+                dot += v * x[j];
+                sum += v;
+                sq += v * v;
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+                expected_yt[j] += v * xt[i];
+                expected_csum[j] += v;
+                expected_cnorm[j] += v * v;
+                assert(cmins[j] <= v && v <= cmaxs[j]);
+            }
+            assert(std::abs(y[i] - (2.0 * dot + 0.5)) < 1e-9);
+            assert(std::abs(sums[i] - sum) < 1e-9);
+            assert(std::abs(norms[i] - std::sqrt(sq)) < 1e-9);
+            assert(mins[i] == lo && maxs[i] == hi);
+        }
+        for (size_t j = 0; j < cols; ++j) {
+            assert(std::abs(yt[j] - expected_yt[j]) < 1e-7);
+            assert(std::abs(csums[j] - expected_csum[j]) < 1e-7);
+            assert(std::abs(cnorms[j] - std::sqrt(expected_cnorm[j])) < 1e-7);
+            bool min_attained = false;
+            bool max_attained = false;
+            for (size_t i = 0; i < rows; ++i) {
+                min_attained |= a(i, j) == cmins[j];
+                max_attained |= a(i, j) == cmaxs[j];
+            }
+            assert(min_attained && max_attained);
+        }
+    }
+
+    // Views reduce only their window; integers work too
+    Matrix<int> m(4, 6);
+    for (size_t i = 0; i < 4; ++i) {
+        for (size_t j = 0; j < 6; ++j) {
+            m(i, j) = static_cast<int>(i * 6 + j);
+        }
+    }
+    auto window = m.view(1, 2, 2, 3);
+    assert((row_sums(window) == std::vector<int>{8 + 9 + 10, 14 + 15 + 16}));
+    assert((col_sums(window) == std::vector<int>{22, 24, 26}));
+    assert((*col_max(window) == std::vector<int>{14, 15, 16}));
+
+    // Shape errors
+    std::vector<int> wrong(5);
+    std::vector<int> out(4);
+    assert(!gemv(1, full_view(m), std::span<const int>(wrong), 0,
+                 std::span<int>(out))
+                .has_value());
+    assert(!row_min(Matrix<int>(3, 0)).has_value());
+    assert(!col_max(Matrix<int>(0, 3)).has_value());
+
+    std::cout << "✓ gemv and reduction tests passed" << std::endl;
+}
+
+void test_tuning() {
+    std::cout << "Testing tuning profiles..." << std::endl;
+
+    // Round trip, comments, unknown keys and partial profiles
+    TuningProfile custom;
+    custom.gemm_block_k = 96;
+    custom.lu_block = 24;
+    custom.gemv_parallel_min = 256;
+    custom.reduce_parallel_min = 128;
+    custom.gemm_interleave_max = 4;
+    custom.gemm_batch_task_flops = 512;
+    custom.quant_block_cols = 16;
+    custom.parallel_init_min_bytes = 4096;
+    custom.stream_store_min_bytes = 16384;
+    auto parsed = TuningProfile::parse(custom.to_string());
+    assert(parsed.has_value() && *parsed == custom);
+    auto partial = TuningProfile::parse(
+        "# comment\n\n  gemm_row_grain = 7 \nfuture_key = 3\n");
+    assert(partial.has_value());
+    assert(partial->gemm_row_grain == 7);
+    assert(partial->gemm_block_k == TuningProfile{}.gemm_block_k);
+    assert(!TuningProfile::parse("gemm_block_k 64").has_value());
+    assert(!TuningProfile::parse("gemm_block_k = 0").has_value());
+    assert(!TuningProfile::parse("gemm_block_k = 12kb").has_value());
+
+    // Files: missing, saved and loaded back, located through the environment
+    auto dir = std::filesystem::temp_directory_path() / "clrs_tuning_test";
+    std::filesystem::remove_all(dir);
+    auto file = dir / "nested" / "tuning.conf";
+    assert(!load_tuning_profile(file).has_value());
+    assert(save_tuning_profile(custom, file).has_value());
+    auto loaded = load_tuning_profile(file);
+    assert(loaded.has_value() && *loaded == custom);
+    setenv(TUNING_PROFILE_ENV, file.c_str(), 1);
+    assert(tuning_profile_path() == file);
+    unsetenv(TUNING_PROFILE_ENV);
+    std::filesystem::remove_all(dir);
+
+    // Kernels give the same results under any profile
+    auto a = random_matrix(67, 150, 3);
+    auto b = random_matrix(150, 41, 4);
+    auto reference = matmul(a, b);
+    auto square = random_matrix(90, 90, 5);
+    std::vector<double> x(150, 0.5);
+    std::vector<double> y_default(67);
+    assert(gemv(1.0, full_view(a), std::span<const double>(x), 0.0,
+                std::span<double>(y_default))
+               .has_value());
+    auto sums_default = row_sums(a);
+    MatrixBatch<double> ba(40, 6, 6, 0.5);
+    MatrixBatch<double> bb(40, 6, 6, -2.0);
+    auto batch_default = *matmul_batched(ba, bb);
+    Matrix<float> fa(30, 70, 0.25f);
+    Matrix<float> fb(70, 50, -0.75f);
+    fa(3, 9) = 1.0f;
+    fb(9, 4) = 2.0f;
+    auto qa = *QuantizedMatrix<int8_t>::quantize(fa);
+    auto qb = *QuantizedMatrix<int8_t>::quantize(fb);
+    auto quant_default = *quantized_matmul(qa, qb);
+    TuningProfile original = tuning();
+    set_tuning(custom);
+    assert(tuning() == custom);
+    auto c = matmul(a, b);
+    assert(c.has_value());
+    for (size_t i = 0; i < 67; i++) {
+        for (size_t j = 0; j < 41; j++) {
+            assert(std::abs((*c)(i, j) - (*reference)(i, j)) < 1e-9);
+        }
+    }
+    auto lu = square;
+    assert(lu_factor(lu.view_mut(0, 0, 90, 90)).has_value());
+    std::vector<double> y(67);
+    assert(gemv(1.0, full_view(a), std::span<const double>(x), 0.0,
+                std::span<double>(y))
+               .has_value());
+    auto sums = row_sums(a);
+    for (size_t i = 0; i < 67; i++) {
+        assert(std::abs(y[i] - y_default[i]) < 1e-9);
+        assert(std::abs(sums[i] - sums_default[i]) < 1e-9);
+    }
+    auto batch = *matmul_batched(ba, bb);
+    assert(std::equal(batch.data(), batch.data() + 40 * 36,
+                      batch_default.data()));
+    auto quant = *quantized_matmul(qa, qb);
+    assert(std::equal(quant.data(), quant.data() + 30 * 50,
+                      quant_default.data()));
+    Matrix<double> filled(100, 90, 1.5);
+    assert(std::all_of(filled.data(), filled.data() + 100 * 90,
+                       [](double v) { return v == 1.5; }));
+    set_tuning(original);
+    auto lu_default = square;
+    assert(lu_factor(lu_default.view_mut(0, 0, 90, 90)).has_value());
+    for (size_t i = 0; i < 90; i++) {
+        for (size_t j = 0; j < 90; j++) {
+            assert(std::abs(lu(i, j) - lu_default(i, j)) < 1e-9);
+        }
+    }
+
+    // A small autotune run picks positive values and restores the profile
+    AutotuneOptions options;
+    options.sort_length = 1000;
+    options.gemm_size = 48;
+    options.lu_size = 64;
+    options.cutoff_length = 4096;
+    options.batch_flops = 1 << 14;
+    options.fill_bytes = 1 << 16;
+    options.repeats = 1;
+    TuningProfile tuned = autotune(options);
+    assert(tuning() == original);
+    assert(TuningProfile::parse(tuned.to_string()).has_value());
+
+    std::cout << "✓ Tuning profile tests passed" << std::endl;
+}
+
+void test_parallel_init() {
+    std::cout << "Testing parallel initialization..." << std::endl;
+
+    // Large enough for the parallel and streaming paths
+    const size_t rows = 1100;
+    const size_t cols = 1003;
+    Matrix<double> filled(rows, cols, 2.5);
+    for (size_t i = 0; i < rows; i += 7) {
+        for (size_t j = 0; j < cols; ++j) {
+            assert(filled(i, j) == 2.5);
+        }
+    }
+    assert(filled(rows - 1, cols - 1) == 2.5);
+    Matrix<double> zeroed(rows, cols);
+    assert(std::all_of(zeroed.data(), zeroed.data() + rows * cols,
+                       [](double x) { return x == 0.0; }));
+
+    filled(17, 4) = -1.0;
+    Matrix<double> copy(filled);
+    assert(std::equal(copy.data(), copy.data() + rows * cols,
+                      filled.data()));
+
+    for (auto placement : {MemoryPlacement::FirstTouch,
+                           MemoryPlacement::Local,
+                           MemoryPlacement::Interleave}) {
+        auto z = Matrix<float>::zeros(1200, 900, placement);
+        assert(z.placement() == placement);
+        assert(std::all_of(z.data(), z.data() + 1200 * 900,
+                           [](float x) { return x == 0.0f; }));
+        Matrix<float> z_copy(z);
+        assert(z_copy.placement() == placement);
+    }
+
+    // Growing keeps the data and zeroes the new tail
+    Matrix<int> grown(300, 300, 7);
+    grown.resize(1000, 600);
+    assert(std::count(grown.data(), grown.data() + 90000, 7) == 90000);
+    assert(std::all_of(grown.data() + 90000, grown.data() + 600000,
+                       [](int x) { return x == 0; }));
+
+    // Unaligned ranges of every width, around the streaming threshold
+    auto pool = ThreadPool::create({.num_threads = 4}).value();
+    for (size_t n : {size_t{0}, size_t{5}, size_t{1} << 18,
+                     (tuning().stream_store_min_bytes >> 1) + 3}) {
+        std::vector<int8_t> bytes(n + 1, 1);
+        parallel_fill(bytes.data() + 1, n, int8_t{-3}, 1, pool.get());
+        assert(bytes[0] == 1);
+        assert(std::count(bytes.begin() + 1, bytes.end(), -3) ==
+               static_cast<long>(n));
+        std::vector<int16_t> source(n);
+        std::iota(source.begin(), source.end(), int16_t{0});
+        std::vector<int16_t> dest(n + 3, 0);
+        parallel_copy(source.data(), n, dest.data() + 3, 100, pool.get());
+        assert(std::equal(source.begin(), source.end(), dest.begin() + 3));
+    }
+
+    // Row kernels get the blocks parallel_fill placed, block w on worker w
+    for (size_t rows : {size_t{0}, size_t{3}, size_t{1001}}) {
+        assert(row_blocks(rows, pool.get()) == std::min<size_t>(rows, 4));
+        std::vector<size_t> owner(rows, 99);
+        parallel_rows(
+            rows,
+            [&](size_t block, size_t lo, size_t hi) {
+                size_t blocks = row_blocks(rows, pool.get());
+                assert(lo == rows * block / blocks);
+                assert(hi == rows * (block + 1) / blocks);
+                assert(pool->is_worker());
+                std::fill(owner.begin() + lo, owner.begin() + hi, block);
+            },
+            pool.get());
+        assert(std::is_sorted(owner.begin(), owner.end()));
+        assert(rows == 0 || owner.back() == row_blocks(rows, pool.get()) - 1);
+    }
+
+    // Non-trivial elements are copied element by element
+    Matrix<std::string> words(3, 2, "x");
+    words(1, 1) = "longer than any small-string buffer";
+    Matrix<std::string> words_copy(words);
+    assert(words_copy(1, 1) == words(1, 1) && words_copy(2, 0) == "x");
+
+    std::cout << "✓ Parallel initialization tests passed" << std::endl;
+}
+
 int main() {
     try {
+        // Several workers even on a small machine, so that the row kernels
+        // take their parallel paths.
+        configure_default_pool({.num_threads = 4}).value();
         test_basic_construction();
         test_element_access();
         test_copy_and_move();
@@ -231,6 +837,14 @@ int main() {
         test_matrix_view_mut();
         test_factory_methods();
         test_edge_cases();
+        test_gemm();
+        test_lu();
+        test_matrix_power();
+        test_gemm_batched();
+        test_quantized();
+        test_gemv_and_reductions();
+        test_tuning();
+        test_parallel_init();
 
         std::cout << "All tests passed successfully!" << std::endl;
         return 0;
@@ -0,0 +1,322 @@
+#include "async.hpp"
+#include "parallel.hpp"
+#include "scan.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cassert>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+void test_pool_configuration() {
+    std::cout << "Testing pool configuration..." << std::endl;
+
+    auto pool = ThreadPool::create({.num_threads = 3});
+    assert(pool.has_value());
+    assert((*pool)->num_workers() == 3);
+
+    auto too_big = ThreadPool::create({.num_threads = MAX_POOL_THREADS + 1});
+    assert(!too_big.has_value());
+
+    auto pinned = ThreadPool::create({.num_threads = 2, .pin_threads = true});
+    assert(pinned.has_value());
+
+    std::cout << "✓ Pool configuration tests passed" << std::endl;
+}
+
+long fib(ThreadPool &pool, int n) {
+    if (n < 12) {
+        return n < 2 ? n : fib(pool, n - 1) + fib(pool, n - 2);
+    }
+    long a = 0;
+    TaskGroup group(pool);
+    group.spawn([&] { a = fib(pool, n - 1); });
+    long b = fib(pool, n - 2);
+    group.sync();
+    return a + b;
+}
+
+void test_fork_join() {
+    std::cout << "Testing fork/join..." << std::endl;
+
+    std::atomic<uint64_t> steals{0};
+    ThreadPoolConfig config{.num_threads = 4};
+    config.hooks.on_steal = [&](size_t, size_t) { steals++; };
+    auto pool = ThreadPool::create(config).value();
+
+    assert(fib(*pool, 25) == 75025);
+
+    // The waiting thread may have run every fib task itself, and it is not
+    // a worker, so only the steal counters can be cross-checked here.
+    uint64_t counted_steals = 0;
+    for (const auto &s : pool->stats()) {
+        counted_steals += s.steals;
+    }
+    assert(counted_steals == steals.load());
+
+    // A task submitted directly and waited for without helping can only run
+    // on a worker, so it is counted once.
+    pool->reset_stats();
+    std::atomic<bool> done{false};
+    pool->submit([&] { done = true; });
+    auto executed = [&] {
+        uint64_t total = 0;
+        for (const auto &s : pool->stats()) {
+            total += s.tasks_executed;
+        }
+        return total;
+    };
+    while (!done || executed() == 0) {
+        std::this_thread::yield();
+    }
+    assert(executed() == 1);
+
+    // Exceptions propagate to sync()
+    TaskGroup group(*pool);
+    group.spawn([] { throw std::runtime_error("boom"); });
+    try {
+        group.sync();
+        assert(false && "Should have thrown exception");
+    } catch (const std::runtime_error &) {
+        // Expected
+    }
+
+    std::cout << "✓ Fork/join tests passed" << std::endl;
+}
+
+void test_parallel_for() {
+    std::cout << "Testing parallel_for..." << std::endl;
+
+    auto pool = ThreadPool::create({.num_threads = 4}).value();
+    std::vector<int> v(100000, 0);
+    parallel_for(0, v.size(), 1000,
+                 [&](size_t lo, size_t hi) {
+                     for (size_t i = lo; i < hi; ++i) {
+                         v[i] += static_cast<int>(i % 7);
+                     }
+                 },
+                 *pool);
+    long sum = std::accumulate(v.begin(), v.end(), 0L);
+    long expected = 0;
+    for (size_t i = 0; i < v.size(); ++i) {
+        expected += static_cast<long>(i % 7);
+    }
+    assert(sum == expected);
+
+    // Default pool, automatic grain
+    std::atomic<size_t> covered{0};
+    parallel_for(0, 12345, 0,
+                 [&](size_t lo, size_t hi) { covered += hi - lo; });
+    assert(covered == 12345);
+    assert(!configure_default_pool({}).has_value());
+
+    // Static partition: one contiguous chunk per worker, in order
+    std::vector<std::pair<size_t, size_t>> chunks(4);
+    std::atomic<size_t> calls{0};
+    parallel_for_static(
+        10, 1010,
+        [&](size_t lo, size_t hi) {
+            chunks[(lo - 10) / 250] = {lo, hi};
+            calls++;
+        },
+        *pool);
+    assert(calls == 4);
+    for (size_t w = 0; w < 4; ++w) {
+        assert(chunks[w].first == 10 + 250 * w);
+        assert(chunks[w].second == 10 + 250 * (w + 1));
+    }
+    // Fewer elements than workers, and an empty range
+    calls = 0;
+    parallel_for_static(0, 3, [&](size_t lo, size_t hi) {
+        assert(hi == lo + 1);
+        calls++;
+    }, *pool);
+    assert(calls == 3);
+    parallel_for_static(5, 5, [&](size_t, size_t) { calls++; }, *pool);
+    assert(calls == 3);
+
+    // Tasks placed on a worker report exceptions like spawned ones
+    TaskGroup group(*pool);
+    group.spawn_on(2, [] { throw std::runtime_error("placed"); });
+    bool caught = false;
+    try {
+        group.sync_on_workers();
+    } catch (const std::runtime_error &) {
+        caught = true;
+    }
+    assert(caught);
+
+    std::cout << "✓ parallel_for tests passed" << std::endl;
+}
+
+Task<long> handler(ThreadPool &pool, std::vector<int> &data) {
+    // A coroutine handler awaiting a background sort
+    auto sorted = co_await async_merge_sort(data, {.pool = &pool});
+    assert(sorted.has_value());
+    long total = co_await run_async(
+        [&] { return std::accumulate(data.begin(), data.end(), 0L); },
+        {.pool = &pool});
+    co_return total;
+}
+
+void test_async() {
+    std::cout << "Testing coroutine entry points..." << std::endl;
+
+    auto pool = ThreadPool::create({.num_threads = 2}).value();
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int> dist(-1000, 1000);
+    std::vector<int> data(300000);
+    for (auto &x : data) {
+        x = dist(gen);
+    }
+    long expected_sum = std::accumulate(data.begin(), data.end(), 0L);
+
+    assert(sync_wait(handler(*pool, data)) == expected_sum);
+    assert(std::is_sorted(data.begin(), data.end()));
+
+    // Progress is reported and cancellation stops the sort early
+    std::reverse(data.begin(), data.end());
+    CancellationSource source;
+    size_t reports = 0;
+    AsyncOptions options{.pool = pool.get(), .token = source.token()};
+    options.progress = [&](size_t done, size_t total) {
+        assert(done <= total);
+        if (++reports == 2) {
+            source.cancel();
+        }
+    };
+    auto cancelled = sync_wait(async_merge_sort(data, options));
+    assert(!cancelled.has_value());
+    assert(reports == 2);
+
+    // Transpose
+    Matrix<int> m(300, 500);
+    for (size_t i = 0; i < 300; ++i) {
+        for (size_t j = 0; j < 500; ++j) {
+            m(i, j) = static_cast<int>(i * 500 + j);
+        }
+    }
+    auto t = sync_wait(async_transpose(m, {.pool = pool.get()}));
+    assert(t.has_value() && t->size() == std::make_pair(500ul, 300ul));
+    assert(t->get_unchecked(499, 299) == m.get_unchecked(299, 499));
+
+    // Exceptions propagate through the awaiting chain
+    try {
+        sync_wait(run_async([]() -> int { throw std::runtime_error("x"); },
+                            {.pool = pool.get()}));
+        assert(false && "Should have thrown exception");
+    } catch (const std::runtime_error &) {
+        // Expected
+    }
+
+    std::cout << "✓ Coroutine tests passed" << std::endl;
+}
+
+void test_scan() {
+    std::cout << "Testing scans..." << std::endl;
+
+    // Serial and parallel (above the cutoff) paths, with SIMD-able types
+    size_t cutoff = tuning().scan_parallel_cutoff;
+    for (size_t n : {0ul, 1ul, 7ul, 8ul, 1001ul, cutoff + 13}) {
+        std::vector<int32_t> v(n);
+        for (size_t i = 0; i < n; ++i) {
+            v[i] = static_cast<int32_t>(i % 5) - 2;
+        }
+        auto expected = v;
+        for (size_t i = 1; i < n; ++i) {
+            expected[i] += expected[i - 1];
+        }
+        inclusive_scan(v);
+        assert(v == expected);
+    }
+
+    std::vector<float> f(100, 0.5f);
+    inclusive_scan(f);
+    assert(f[99] == 50.0f);
+
+    std::vector<long> e = {3, 1, 4, 1, 5};
+    assert(exclusive_scan(e) == 14);
+    assert((e == std::vector<long>{0, 3, 4, 8, 9}));
+
+    // Custom associative, non-commutative operator: running max
+    std::vector<int> m = {1, 5, 2, 7, 3};
+    inclusive_scan(m, [](int a, int b) { return std::max(a, b); }, INT32_MIN);
+    assert((m == std::vector<int>{1, 5, 5, 7, 7}));
+
+    // Segmented scan and scan by key, serial and parallel
+    std::vector<int> seg = {1, 1, 1, 1, 1};
+    assert(segmented_scan(seg, {true, false, true, false, false}).has_value());
+    assert((seg == std::vector<int>{1, 2, 1, 2, 3}));
+
+    size_t big = cutoff * 2;
+    std::vector<int> keys(big);
+    std::vector<long> values(big, 1);
+    for (size_t i = 0; i < big; ++i) {
+        keys[i] = static_cast<int>(i / 1000);
+    }
+    assert(scan_by_key(keys, values).has_value());
+    for (size_t i = 0; i < big; ++i) {
+        assert(values[i] == static_cast<long>(i % 1000 + 1));
+    }
+    assert(!scan_by_key(keys, e).has_value());
+
+    // Matrix rows and columns
+    Matrix<int> mat(3, 4, 1);
+    scan_rows(mat);
+    assert(mat(2, 3) == 4);
+    scan_cols(mat);
+    assert(mat(2, 3) == 12 && mat(0, 3) == 4 && mat(2, 0) == 3);
+
+    // Large enough for the two-pass block scans over the row blocks
+    Matrix<long> wide(1003, 301);
+    for (size_t i = 0; i < wide.nrows(); ++i) {
+        for (size_t j = 0; j < wide.ncols(); ++j) {
+            wide(i, j) = static_cast<long>((i * 7 + j * 3) % 11);
+        }
+    }
+    auto by_cols = wide;
+    scan_cols(by_cols);
+    auto by_rows = wide;
+    scan_rows(by_rows);
+    std::vector<long> col_total(wide.ncols(), 0);
+    for (size_t i = 0; i < wide.nrows(); ++i) {
+        long row_total = 0;
+        for (size_t j = 0; j < wide.ncols(); ++j) {
+            col_total[j] += wide(i, j);
+            row_total += wide(i, j);
+            assert(by_cols(i, j) == col_total[j]);
+            assert(by_rows(i, j) == row_total);
+        }
+    }
+
+    std::cout << "✓ Scan tests passed" << std::endl;
+}
+
+int main() {
+    try {
+        // Several workers even on a small machine, so that the parallel
+        // paths run.
+        configure_default_pool({.num_threads = 4}).value();
+        test_pool_configuration();
+        test_fork_join();
+        test_parallel_for();
+        test_async();
+        test_scan();
+
+        std::cout << "All tests passed successfully!" << std::endl;
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "Test failed with unknown exception" << std::endl;
+        return 1;
+    }
+}
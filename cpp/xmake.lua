@@ -7,6 +7,12 @@ add_includedirs("src")
 target("CLRS")
     set_kind("binary")
     add_files("src/main.cpp")
-    add_headerfiles("src/utils.hpp", "src/error.hpp", "src/matrix.hpp")
+    add_headerfiles("src/utils.hpp", "src/error.hpp", "src/matrix.hpp",
+                    "src/parallel.hpp", "src/async.hpp", "src/scan.hpp",
+                    "src/linalg.hpp", "src/matrix_power.hpp",
+                    "src/batched_gemm.hpp", "src/quantized.hpp",
+                    "src/reduction.hpp", "src/tuning.hpp",
+                    "src/autotune.hpp", "src/memory.hpp")
+    add_syslinks("pthread")
 
 includes("src/chapter2", "src/chapter4")